@@ -1,6 +1,6 @@
 // Buffer cache.
 //
-// The buffer cache is a linked list of buf structures holding
+// The buffer cache is a hash table of buf structures holding
 // cached copies of disk block contents.  Caching disk blocks
 // in memory reduces the number of disk reads and also provides
 // a synchronization point for disk blocks used by multiple processes.
@@ -23,38 +23,334 @@
 #include "fs.h"
 #include "buf.h"
 
-struct {
+// Buffers are found through a hash table keyed on (dev, blockno);
+// each bucket has its own lock, so lookups, brelse, bpin and bunpin
+// on different blocks don't contend. Only misses take evict_lock,
+// which serializes replacement.
+//
+// Replacement is a CLOCK sweep made scan-resistant in the manner of
+// 2Q. A newly filled buffer is on probation (hot == 0, used == 0):
+// unless it is looked up again before the hand comes round it is the
+// first to go, so a one-pass read of a big file only recycles
+// probationary buffers. A lookup sets b->used, except within the
+// first nbuf/BCACHE_CORREL_DIV misses after the fill (2Q's correlated
+// reference period), so that re-reading a block just read, as
+// verify_inode_checksum() does after a whole-file read, doesn't count.
+// The hand promotes a probationary buffer with used set to hot, and
+// takes a hot buffer through used -> not used -> probation before it
+// can be evicted. Build with BCACHE_2Q=0 for plain CLOCK.
+//
+// The cache is sized at run time. Buffers come in groups of BG_NBUF:
+// one kalloc page of buf headers plus the data pages they point into.
+// A miss takes a free buffer if there is one, else adds a group while
+// the cache is under its limit (BCACHE_MAX_PCT of RAM) and memory is
+// not short, else evicts. kalloc() calls bcache_shrink() when free
+// memory runs low, which returns idle groups to the page allocator
+// but never goes below BCACHE_MIN_BUFS.
+//
+// Lock order: evict_lock, then the bucket being filled, then the
+// victim's bucket. Everything else holds at most one bucket lock.
+// Nothing allocates memory while holding any of them.
+
+#define BG_NBUF      32
+#define BCACHE_CORREL_DIV 4
+#define BG_DATAPAGES (BG_NBUF * BSIZE / PGSIZE)      // at the current BSIZE
+#define BG_MAXPAGES  (BG_NBUF * BSIZE_MAX / PGSIZE)
+
+struct bgroup {
+  struct bgroup *next;
+  int npages;
+  char *pages[BG_MAXPAGES];
+  struct buf buf[BG_NBUF];
+};
+
+struct bucket {
   struct spinlock lock;
-  struct buf buf[NBUF];
+  struct buf *head;     // hash chain, through next
+  uint64 searches;      // chain searches, under lock
+  uint64 steps;         // buffers examined by them
+};
+
+struct {
+  struct bucket bucket[NBUCKET];
+
+  struct spinlock evict_lock;
+  // the rest is protected by evict_lock.
+  struct bgroup *groups;
+  struct buf *freelist; // buffers holding no block, through next
+  int nbuf;             // buffers in all groups
+  int maxbuf;           // limit from BCACHE_MAX_PCT
+  struct bgroup *hand_g; // CLOCK hand: group and index in it
+  int hand_i;
+  uint nmiss;           // misses so far, for b->stamp
+  uint meta_start;      // blocks [meta_start, meta_end) are inodes
+  uint meta_end;        // and bitmap, counted separately
+  uint64 promotions;    // probation -> hot
+  uint64 grows;
+  uint64 shrinks;
+  int ready;
 
-  // Linked list of all buffers, through prev/next.
-  // Sorted by how recently the buffer was used.
-  // head.next is most recent, head.prev is least.
-  struct buf head;
+  // readahead, updated with atomics.
+  uint64 ra_issued;     // async reads started
+  uint64 ra_hits;       // of those, later read by bread()
+  uint64 ra_waste;      // of those, evicted unread
 } bcache;
 
-// runtime counters for Stage 6 telemetry
-uint bio_io_reads = 0;
-uint bio_io_writes = 0;
-uint bio_checksum_errors = 0; // placeholder, not used yet
+// Per-hart counters. Each hart only touches its own entry, with
+// interrupts off so it can't be moved meanwhile; bcache_stats()
+// adds them up.
+struct biostat {
+  uint64 lookups;     // bget() calls
+  uint64 hits;        // of those, found cached
+  uint64 meta_lookups; // bget() calls for inode and bitmap blocks
+  uint64 meta_hits;
+  uint64 misses;      // of those, given a fresh buffer
+  uint64 evictions;   // cached blocks dropped to reuse or free a buffer
+  uint64 writebacks;  // logged blocks written to their home location
+  uint64 dev_reads;   // blocks read from the disk
+  uint64 dev_writes;  // blocks written to the disk
+};
+static struct biostat biostat[NCPU];
 
-void
-binit(void)
+#define BSTAT(f, n) do { push_off(); biostat[cpuid()].f += (n); pop_off(); } while(0)
+
+uint bio_checksum_errors = 0;
+
+// Block size of the mounted file system; BSIZE in the kernel.
+// Starts at BSIZE_MIN for reading the superblock.
+uint fs_bsize = BSIZE_MIN;
+
+static struct bucket*
+bhash(uint dev, uint blockno)
+{
+  return &bcache.bucket[(dev * 31 + blockno) % NBUCKET];
+}
+
+static void
+bucket_insert(struct bucket *bk, struct buf *b)
+{
+  b->next = bk->head;
+  bk->head = b;
+}
+
+static void
+bucket_remove(struct bucket *bk, struct buf *b)
+{
+  struct buf **pp;
+
+  for(pp = &bk->head; *pp; pp = &(*pp)->next){
+    if(*pp == b){
+      *pp = b->next;
+      return;
+    }
+  }
+  panic("bucket_remove");
+}
+
+// Find the cached buffer for (dev, blockno) in bk, or 0.
+// Caller must hold bk->lock.
+static struct buf*
+bucket_find(struct bucket *bk, uint dev, uint blockno)
 {
   struct buf *b;
 
-  initlock(&bcache.lock, "bcache");
+  bk->searches++;
+  for(b = bk->head; b; b = b->next){
+    bk->steps++;
+    if(b->dev == dev && b->blockno == blockno)
+      return b;
+  }
+  return 0;
+}
+
+// Return a group's pages to kalloc. It must be unlinked.
+static void
+bgroup_free(struct bgroup *g)
+{
+  for(int i = 0; i < g->npages; i++)
+    kfree(g->pages[i]);
+  kfree(g);
+}
+
+// Allocate and link in one more group of buffers.
+// Returns 0, or -1 if the cache is at its limit or memory is short.
+// Called with no locks held.
+static int
+bgrow(void)
+{
+  struct bgroup *g;
+  uint total, freep;
+  int i;
 
-  // Create linked list of buffers
-  bcache.head.prev = &bcache.head;
-  bcache.head.next = &bcache.head;
-  for(b = bcache.buf; b < bcache.buf+NBUF; b++){
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
+  kalloc_stats(&total, &freep);
+  if(freep < MEM_LOW_WATERMARK_PAGES + 2*(BG_DATAPAGES + 1))
+    return -1;
+  if((g = (struct bgroup*)kalloc()) == 0)
+    return -1;
+  memset(g, 0, sizeof(*g));
+  for(i = 0; i < BG_DATAPAGES; i++){
+    if((g->pages[i] = kalloc()) == 0){
+      bgroup_free(g);
+      return -1;
+    }
+    g->npages++;
+  }
+  for(i = 0; i < BG_NBUF; i++){
+    struct buf *b = &g->buf[i];
     initsleeplock(&b->lock, "buffer");
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
+    b->data = (uchar*)g->pages[i / (PGSIZE/BSIZE)] + (i % (PGSIZE/BSIZE)) * BSIZE;
+    b->dev = ~0;
+  }
+
+  acquire(&bcache.evict_lock);
+  if(bcache.nbuf + BG_NBUF > bcache.maxbuf){
+    // lost a race with another grower.
+    release(&bcache.evict_lock);
+    bgroup_free(g);
+    return -1;
   }
+  for(i = 0; i < BG_NBUF; i++){
+    g->buf[i].next = bcache.freelist;
+    bcache.freelist = &g->buf[i];
+  }
+  g->next = bcache.groups;
+  bcache.groups = g;
+  bcache.nbuf += BG_NBUF;
+  bcache.grows++;
+  release(&bcache.evict_lock);
+  return 0;
+}
+
+// Set the size limit for the current BSIZE and allocate the
+// minimum number of buffers.
+static void
+bfill(void)
+{
+  uint total;
+
+  kalloc_stats(&total, 0);
+  bcache.maxbuf = (uint64)total * BCACHE_MAX_PCT / 100 * (PGSIZE/BSIZE);
+  if(bcache.maxbuf < BCACHE_MIN_BUFS)
+    bcache.maxbuf = BCACHE_MIN_BUFS;
+  while(bcache.nbuf < BCACHE_MIN_BUFS){
+    if(bgrow() < 0)
+      panic("bfill");
+  }
+}
+
+void
+binit(void)
+{
+  struct bucket *bk;
+
+  if(sizeof(struct bgroup) > PGSIZE || PGSIZE % BSIZE_MAX)
+    panic("binit: bgroup");
+
+  initlock(&bcache.evict_lock, "bcache.evict");
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++){
+    initlock(&bk->lock, "bcache.bucket");
+    bk->head = 0;
+  }
+  bfill();
+  bcache.ready = 1;
+}
+
+// Tell the cache which blocks hold inodes and the free bitmap,
+// for the metadata hit counts.
+void
+bsetmeta(uint start, uint end)
+{
+  bcache.meta_start = start;
+  bcache.meta_end = end;
+}
+
+// Switch to bsize-byte blocks. Called once at mount, after the
+// superblock has been found and released: every buffer is dropped
+// and the cache is rebuilt with data slots of the new size.
+void
+bsetsize(uint bsize)
+{
+  struct bgroup *g, *groups;
+
+  if(bsize == fs_bsize)
+    return;
+  if(bsize < BSIZE_MIN || bsize > BSIZE_MAX || PGSIZE % bsize)
+    panic("bsetsize");
+
+  acquire(&bcache.evict_lock);
+  for(g = bcache.groups; g; g = g->next){
+    for(int i = 0; i < BG_NBUF; i++){
+      struct buf *b = &g->buf[i];
+      if(b->refcnt)
+        panic("bsetsize: busy");
+      if(b->dev != ~0){
+        struct bucket *bk = bhash(b->dev, b->blockno);
+        acquire(&bk->lock);
+        bucket_remove(bk, b);
+        release(&bk->lock);
+      }
+    }
+  }
+  groups = bcache.groups;
+  bcache.groups = 0;
+  bcache.freelist = 0;
+  bcache.nbuf = 0;
+  bcache.hand_g = 0;
+  bcache.hand_i = 0;
+  fs_bsize = bsize;
+  release(&bcache.evict_lock);
+
+  while((g = groups) != 0){
+    groups = g->next;
+    bgroup_free(g);
+  }
+  bfill();
+}
+
+// Advance the CLOCK hand and return the buffer it was on.
+// Caller must hold evict_lock.
+static struct buf*
+clock_next(void)
+{
+  if(bcache.hand_g == 0){
+    bcache.hand_g = bcache.groups;
+    bcache.hand_i = 0;
+  }
+  struct buf *b = &bcache.hand_g->buf[bcache.hand_i];
+  if(++bcache.hand_i == BG_NBUF){
+    bcache.hand_g = bcache.hand_g->next;
+    bcache.hand_i = 0;
+  }
+  return b;
+}
+
+// Make b hold (dev, blockno) in bucket bk, referenced once.
+// Caller holds evict_lock and bk->lock, and b is in no bucket.
+static void
+bassign(struct buf *b, struct bucket *bk, uint dev, uint blockno)
+{
+  b->dev = dev;
+  b->blockno = blockno;
+  b->valid = 0;
+  b->refcnt = 1;
+  b->used = !BCACHE_2Q;
+  b->hot = 0;
+  b->stamp = bcache.nmiss++;
+  b->readahead = 0;
+  b->logseq = 0;
+  b->verified = 0;
+  bucket_insert(bk, b);
+  BSTAT(misses, 1);
+}
+
+// A lookup found b. Caller holds b's bucket lock.
+static void
+btouch(struct buf *b)
+{
+  b->refcnt++;
+  if(!BCACHE_2Q || b->hot ||
+     bcache.nmiss - b->stamp >= bcache.nbuf / BCACHE_CORREL_DIV)
+    b->used = 1;
 }
 
 // Look through buffer cache for block on device dev.
@@ -64,33 +360,96 @@ static struct buf*
 bget(uint dev, uint blockno)
 {
   struct buf *b;
+  struct bucket *bk = bhash(dev, blockno);
+  int grown = 0;
+  int meta = blockno >= bcache.meta_start && blockno < bcache.meta_end;
 
-  acquire(&bcache.lock);
+  BSTAT(lookups, 1);
+  if(meta)
+    BSTAT(meta_lookups, 1);
+  acquire(&bk->lock);
 
   // Is the block already cached?
-  for(b = bcache.head.next; b != &bcache.head; b = b->next){
-    if(b->dev == dev && b->blockno == blockno){
-      b->refcnt++;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
+  if((b = bucket_find(bk, dev, blockno)) != 0){
+    btouch(b);
+    release(&bk->lock);
+    BSTAT(hits, 1);
+    if(meta)
+      BSTAT(meta_hits, 1);
+    acquiresleep(&b->lock);
+    return b;
+  }
+  release(&bk->lock);
+
+  for(;;){
+    acquire(&bcache.evict_lock);
+    acquire(&bk->lock);
+
+    // Another process may have read it in while we held no lock.
+    if((b = bucket_find(bk, dev, blockno)) != 0){
+      btouch(b);
+      BSTAT(hits, 1);
+      if(meta)
+        BSTAT(meta_hits, 1);
+      goto out;
+    }
+
+    // A buffer holding nothing?
+    if((b = bcache.freelist) != 0){
+      bcache.freelist = b->next;
+      bassign(b, bk, dev, blockno);
+      goto out;
+    }
+
+    // Room to grow? bgrow() allocates, so drop the locks first.
+    if(!grown && bcache.nbuf + BG_NBUF <= bcache.maxbuf){
+      release(&bk->lock);
+      release(&bcache.evict_lock);
+      grown = 1;
+      bgrow();
+      continue;
     }
+    break;
   }
 
-  // Not cached.
-  // Recycle the least recently used (LRU) unused buffer.
-  for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
-    if(b->refcnt == 0) {
-      b->dev = dev;
-      b->blockno = blockno;
-      b->valid = 0;
-      b->refcnt = 1;
-      release(&bcache.lock);
-      acquiresleep(&b->lock);
-      return b;
+  // Sweep the CLOCK. Three full turns: a hot buffer needs two
+  // passes to lose its used bit and then its place.
+  for(int i = 0; i < 3*bcache.nbuf; i++){
+    b = clock_next();
+
+    // b->dev and b->blockno only change under evict_lock.
+    struct bucket *vb = bhash(b->dev, b->blockno);
+    if(vb != bk)
+      acquire(&vb->lock);
+    if(b->refcnt == 0 && b->used){
+      // used since the hand last came by: keep, promoting if on probation.
+      b->used = 0;
+      if(BCACHE_2Q && !b->hot){
+        b->hot = 1;
+        bcache.promotions++;
+      }
+    } else if(b->refcnt == 0 && b->hot){
+      b->hot = 0;
+    } else if(b->refcnt == 0){
+      if(b->readahead)
+        __sync_fetch_and_add(&bcache.ra_waste, 1);
+      BSTAT(evictions, 1);
+      bucket_remove(vb, b);
+      if(vb != bk)
+        release(&vb->lock);
+      bassign(b, bk, dev, blockno);
+      goto out;
     }
+    if(vb != bk)
+      release(&vb->lock);
   }
   panic("bget: no buffers");
+
+out:
+  release(&bk->lock);
+  release(&bcache.evict_lock);
+  acquiresleep(&b->lock);
+  return b;
 }
 
 // Return a locked buf with the contents of the indicated block.
@@ -103,11 +462,144 @@ bread(uint dev, uint blockno)
   if(!b->valid) {
     virtio_disk_rw(b, 0);
     b->valid = 1;
+    BSTAT(dev_reads, 1);
+  }
+  if(b->readahead){
+    b->readahead = 0;
+    __sync_fetch_and_add(&bcache.ra_hits, 1);
+  }
+  return b;
+}
+
+// Return a locked buf for the block, filled with zeros instead of
+// read from disk: for a block that was just allocated.
+struct buf*
+bclear(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  memset(b->data, 0, BSIZE);
+  b->valid = 1;
+  if(b->readahead){
+    b->readahead = 0;
+    __sync_fetch_and_add(&bcache.ra_waste, 1);
   }
-  bio_io_reads++;
   return b;
 }
 
+// Return locked bufs for the n consecutive blocks starting at
+// blockno in bs[0..n-1], n at most MAXRANGE. Each run of blocks
+// that are not cached is read with a single disk request.
+// Returns the number of bufs returned.
+int
+bread_range(uint dev, uint blockno, int n, struct buf **bs)
+{
+  int i, j;
+
+  if(n > MAXRANGE)
+    n = MAXRANGE;
+  // ascending block order, like any other holder of several bufs.
+  for(i = 0; i < n; i++)
+    bs[i] = bget(dev, blockno + i);
+
+  for(i = 0; i < n; i = j){
+    if(bs[i]->valid){
+      j = i + 1;
+      continue;
+    }
+    for(j = i + 1; j < n && !bs[j]->valid; j++)
+      ;
+    virtio_disk_rw_range(bs + i, j - i, 0);
+    for(int k = i; k < j; k++)
+      bs[k]->valid = 1;
+    BSTAT(dev_reads, j - i);
+  }
+
+  for(i = 0; i < n; i++){
+    if(bs[i]->readahead){
+      bs[i]->readahead = 0;
+      __sync_fetch_and_add(&bcache.ra_hits, 1);
+    }
+  }
+  return n;
+}
+
+// Write the locked bufs bs[0..n-1] as one batch: each stretch of
+// consecutive blocks goes out as a single disk request, and all the
+// requests are in flight together.
+void
+bwrite_batch(struct buf **bs, int n)
+{
+  for(int i = 0; i < n; i++){
+    if(!holdingsleep(&bs[i]->lock))
+      panic("bwrite_batch");
+  }
+  virtio_disk_rw_batch(bs, n, 1);
+  BSTAT(dev_writes, n);
+}
+
+// Write blocks to their home locations from bufs outside the
+// cache (the log checkpointer's), as one batch like bwrite_batch().
+void
+bwriteback(struct buf **bs, int n)
+{
+  virtio_disk_rw_batch(bs, n, 1);
+  BSTAT(dev_writes, n);
+  BSTAT(writebacks, n);
+}
+
+// Start reading a block into the cache without waiting for it.
+// Returns 0 if the read was started or the block is already cached,
+// -1 if the disk queue is full and the caller should stop.
+int
+breadahead(uint dev, uint blockno)
+{
+  struct bucket *bk = bhash(dev, blockno);
+  struct buf *b;
+
+  // cheap look first, so readahead of cached blocks does not count
+  // as a lookup or wait on a busy buffer.
+  acquire(&bk->lock);
+  for(b = bk->head; b; b = b->next)
+    if(b->dev == dev && b->blockno == blockno)
+      break;
+  release(&bk->lock);
+  if(b)
+    return 0;
+
+  b = bget(dev, blockno);
+  if(b->valid){
+    brelse(b);
+    return 0;
+  }
+  b->readahead = 1;
+  if(virtio_disk_read_async(b) < 0){
+    b->readahead = 0;
+    brelse(b);
+    return -1;
+  }
+  // b stays locked and referenced until bio_async_done().
+  __sync_fetch_and_add(&bcache.ra_issued, 1);
+  BSTAT(dev_reads, 1);
+  return 0;
+}
+
+// A readahead read has finished: b now holds the block.
+// Drop the lock and reference breadahead() kept.
+// Called from virtio_disk_intr(), so no holdingsleep() check.
+void
+bio_async_done(struct buf *b)
+{
+  struct bucket *bk = bhash(b->dev, b->blockno);
+
+  b->valid = 1;
+  releasesleep(&b->lock);
+  acquire(&bk->lock);
+  b->refcnt--;
+  release(&bk->lock);
+}
+
 // Write b's contents to disk.  Must be locked.
 void
 bwrite(struct buf *b)
@@ -115,11 +607,12 @@ bwrite(struct buf *b)
   if(!holdingsleep(&b->lock))
     panic("bwrite");
   virtio_disk_rw(b, 1);
-  bio_io_writes++;
+  BSTAT(dev_writes, 1);
 }
 
 // Release a locked buffer.
-// Move to the head of the most-recently-used list.
+// A referenced buffer is never evicted, so b->dev and b->blockno
+// are stable here and name the right bucket.
 void
 brelse(struct buf *b)
 {
@@ -128,33 +621,139 @@ brelse(struct buf *b)
 
   releasesleep(&b->lock);
 
-  acquire(&bcache.lock);
+  struct bucket *bk = bhash(b->dev, b->blockno);
+  acquire(&bk->lock);
   b->refcnt--;
-  if (b->refcnt == 0) {
-    // no one is waiting for it.
-    b->next->prev = b->prev;
-    b->prev->next = b->next;
-    b->next = bcache.head.next;
-    b->prev = &bcache.head;
-    bcache.head.next->prev = b;
-    bcache.head.next = b;
-  }
-  
-  release(&bcache.lock);
+  release(&bk->lock);
 }
 
 void
 bpin(struct buf *b) {
-  acquire(&bcache.lock);
+  struct bucket *bk = bhash(b->dev, b->blockno);
+  acquire(&bk->lock);
   b->refcnt++;
-  release(&bcache.lock);
+  release(&bk->lock);
 }
 
 void
 bunpin(struct buf *b) {
-  acquire(&bcache.lock);
+  struct bucket *bk = bhash(b->dev, b->blockno);
+  acquire(&bk->lock);
   b->refcnt--;
-  release(&bcache.lock);
+  release(&bk->lock);
 }
 
+// Memory is short: give one idle group back to kalloc.
+// An idle group is one in which no buffer is referenced; its cached
+// blocks are dropped. Returns the number of pages freed.
+// Called from kalloc() with no bcache locks held.
+int
+bcache_shrink(void)
+{
+  struct bgroup *g, **pg;
+  struct buf *b, **pb;
+  int i, n = 0;
+
+  if(!bcache.ready || holding(&bcache.evict_lock))
+    return 0;
+  acquire(&bcache.evict_lock);
+  if(bcache.nbuf - BG_NBUF < BCACHE_MIN_BUFS){
+    release(&bcache.evict_lock);
+    return 0;
+  }
+
+  for(pg = &bcache.groups; (g = *pg) != 0; pg = &g->next){
+    // unlocked first look: skip groups that are obviously busy.
+    for(i = 0; i < BG_NBUF; i++)
+      if(g->buf[i].refcnt)
+        break;
+    if(i < BG_NBUF)
+      continue;
 
+    // take the group's buffers out of their buckets; a buffer that
+    // got referenced meanwhile stops us.
+    for(i = 0; i < BG_NBUF; i++){
+      b = &g->buf[i];
+      if(b->dev == ~0)
+        continue;
+      struct bucket *bk = bhash(b->dev, b->blockno);
+      acquire(&bk->lock);
+      if(b->refcnt){
+        release(&bk->lock);
+        break;
+      }
+      bucket_remove(bk, b);
+      if(b->readahead)
+        __sync_fetch_and_add(&bcache.ra_waste, 1);
+      BSTAT(evictions, 1);
+      b->readahead = 0;
+      b->dev = ~0;
+      b->next = bcache.freelist;
+      bcache.freelist = b;
+      release(&bk->lock);
+    }
+    if(i < BG_NBUF)
+      continue;
+
+    // every buffer of g is now on the free list; unlink them all.
+    for(pb = &bcache.freelist; *pb; ){
+      if(*pb >= &g->buf[0] && *pb < &g->buf[BG_NBUF])
+        *pb = (*pb)->next;
+      else
+        pb = &(*pb)->next;
+    }
+    *pg = g->next;
+    if(bcache.hand_g == g)
+      bcache.hand_g = 0;
+    bcache.nbuf -= BG_NBUF;
+    bcache.shrinks++;
+    release(&bcache.evict_lock);
+
+    n = g->npages + 1;
+    bgroup_free(g);
+    return n;
+  }
+  release(&bcache.evict_lock);
+  return n;
+}
+
+// Buffer cache lookup cost and lock contention, for statfs.
+// Counters are read without locks; totals may be slightly stale.
+void
+bcache_stats(struct hai_statfs *st)
+{
+  struct bucket *bk;
+
+  st->bcache_nbuf = bcache.nbuf;
+  st->bcache_maxbuf = bcache.maxbuf;
+  st->bcache_buckets = NBUCKET;
+  st->bcache_grows = bcache.grows;
+  st->bcache_shrinks = bcache.shrinks;
+  st->bcache_promotions = bcache.promotions;
+  st->bcache_ra_issued = bcache.ra_issued;
+  st->bcache_ra_hits = bcache.ra_hits;
+  st->bcache_ra_waste = bcache.ra_waste;
+  for(bk = bcache.bucket; bk < bcache.bucket+NBUCKET; bk++){
+    st->bcache_searches += bk->searches;
+    st->bcache_chain_steps += bk->steps;
+    st->bcache_lock_acquires += bk->lock.nacquire;
+    st->bcache_lock_spins += bk->lock.nspin;
+  }
+  st->bcache_lock_acquires += bcache.evict_lock.nacquire;
+  st->bcache_lock_spins += bcache.evict_lock.nspin;
+
+  for(int i = 0; i < NCPU; i++){
+    struct biostat *bs = &biostat[i];
+    st->bcache_lookups += bs->lookups;
+    st->bcache_hits += bs->hits;
+    st->bcache_meta_lookups += bs->meta_lookups;
+    st->bcache_meta_hits += bs->meta_hits;
+    st->bcache_misses += bs->misses;
+    st->bcache_evictions += bs->evictions;
+    st->bcache_writebacks += bs->writebacks;
+    st->bcache_dev_reads += bs->dev_reads;
+    st->bcache_dev_writes += bs->dev_writes;
+  }
+  st->io_reads = st->bcache_dev_reads;
+  st->io_writes = st->bcache_dev_writes;
+}
@@ -5,8 +5,13 @@ struct buf {
   uint blockno;
   struct sleeplock lock;
   uint refcnt;
-  struct buf *prev; // LRU cache list
-  struct buf *next;
-  uchar data[BSIZE];
+  int used;         // CLOCK reference bit, set on lookup
+  int hot;          // survived probation (see bio.c)
+  uint stamp;       // bcache miss count when filled
+  int readahead;    // filled by readahead and not read since
+  uint logseq;      // last log transaction that logged it, 0 if none
+  int verified;     // file data checked against its block checksum
+  struct buf *next; // hash bucket chain, or free list
+  uchar *data;      // BSIZE bytes in a kalloc'd page
 };
 
@@ -0,0 +1,139 @@
+// Checksum kernels for file data and log commit blocks.
+//
+// Adler-32 defers its two modulo operations to once every
+// ADLER_NMAX bytes and takes aligned input a 64-bit word at a time.
+// CRC32C (Castagnoli) uses slicing-by-8 tables built by csum_init().
+// Neither uses kernel services, so the csumbench user program links
+// this file too.
+
+#include "types.h"
+
+#define ADLER_BASE 65521
+// largest n with 255*n*(n+1)/2 + (n+1)*(BASE-1) < 2^32: b cannot
+// overflow between reductions.
+#define ADLER_NMAX 5552
+
+#define CRC32C_POLY 0x82f63b78  // reflected Castagnoli polynomial
+
+static uint crc32c_table[8][256];
+// crc32c_zeros_op[k] advances a CRC register over 2^k zero bytes.
+static uint crc32c_zeros_op[32][32];
+
+// Adler-32 of 8 bytes w (little-endian) added to a, b.
+#define ADLER_WORD(a, b, w) do {                                        \
+    uint _x0 = (w) & 0xff, _x1 = ((w) >> 8) & 0xff;                     \
+    uint _x2 = ((w) >> 16) & 0xff, _x3 = ((w) >> 24) & 0xff;            \
+    uint _x4 = ((w) >> 32) & 0xff, _x5 = ((w) >> 40) & 0xff;            \
+    uint _x6 = ((w) >> 48) & 0xff, _x7 = (w) >> 56;                     \
+    (b) += 8*(a) + 8*_x0 + 7*_x1 + 6*_x2 + 5*_x3 +                      \
+           4*_x4 + 3*_x5 + 2*_x6 + _x7;                                 \
+    (a) += _x0 + _x1 + _x2 + _x3 + _x4 + _x5 + _x6 + _x7;               \
+  } while(0)
+
+uint
+adler32_update(uint adler, const uchar *p, int len)
+{
+  uint a = adler & 0xffff;
+  uint b = (adler >> 16) & 0xffff;
+
+  while(len > 0){
+    int n = len < ADLER_NMAX ? len : ADLER_NMAX;
+    len -= n;
+    for(; n > 0 && ((uint64)p & 7); n--){
+      a += *p++;
+      b += a;
+    }
+    for(; n >= 16; n -= 16, p += 16){
+      uint64 w0 = ((const uint64*)p)[0];
+      uint64 w1 = ((const uint64*)p)[1];
+      ADLER_WORD(a, b, w0);
+      ADLER_WORD(a, b, w1);
+    }
+    for(; n > 0; n--){
+      a += *p++;
+      b += a;
+    }
+    a %= ADLER_BASE;
+    b %= ADLER_BASE;
+  }
+  return (b << 16) | a;
+}
+
+// Feed len bytes into the CRC32C register crc. The register is not
+// inverted here: a standard CRC32C is ~crc32c_update(~0, p, len).
+uint
+crc32c_update(uint crc, const uchar *p, int len)
+{
+  for(; len > 0 && ((uint64)p & 7); len--)
+    crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  for(; len >= 8; len -= 8, p += 8){
+    uint64 w = *(const uint64*)p ^ crc;
+    crc = crc32c_table[7][w & 0xff] ^
+          crc32c_table[6][(w >> 8) & 0xff] ^
+          crc32c_table[5][(w >> 16) & 0xff] ^
+          crc32c_table[4][(w >> 24) & 0xff] ^
+          crc32c_table[3][(w >> 32) & 0xff] ^
+          crc32c_table[2][(w >> 40) & 0xff] ^
+          crc32c_table[1][(w >> 48) & 0xff] ^
+          crc32c_table[0][w >> 56];
+  }
+  for(; len > 0; len--)
+    crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+// GF(2) 32x32 matrix times vector.
+static uint
+gf2_times(const uint *mat, uint vec)
+{
+  uint sum = 0;
+  for(; vec; vec >>= 1, mat++)
+    if(vec & 1)
+      sum ^= *mat;
+  return sum;
+}
+
+static void
+gf2_square(uint *sq, const uint *mat)
+{
+  for(int i = 0; i < 32; i++)
+    sq[i] = gf2_times(mat, mat[i]);
+}
+
+// The register crc32c_update() would hold after len more zero
+// bytes, in O(log len). Since a CRC is linear, this is what moves
+// the CRC of a changed range to the end of the file, see writei().
+uint
+crc32c_zeros(uint crc, uint len)
+{
+  for(int k = 0; len; k++, len >>= 1)
+    if(len & 1)
+      crc = gf2_times(crc32c_zeros_op[k], crc);
+  return crc;
+}
+
+void
+csum_init(void)
+{
+  for(int i = 0; i < 256; i++){
+    uint c = i;
+    for(int j = 0; j < 8; j++)
+      c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+    crc32c_table[0][i] = c;
+  }
+  for(int i = 0; i < 256; i++)
+    for(int t = 1; t < 8; t++)
+      crc32c_table[t][i] = crc32c_table[0][crc32c_table[t-1][i] & 0xff] ^
+                           (crc32c_table[t-1][i] >> 8);
+
+  // one zero bit, then square up to one zero byte.
+  uint bit[32], two[32], four[32];
+  bit[0] = CRC32C_POLY;
+  for(int i = 1; i < 32; i++)
+    bit[i] = 1u << (i - 1);
+  gf2_square(two, bit);
+  gf2_square(four, two);
+  gf2_square(crc32c_zeros_op[0], four);
+  for(int k = 1; k < 32; k++)
+    gf2_square(crc32c_zeros_op[k], crc32c_zeros_op[k-1]);
+}
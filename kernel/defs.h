@@ -9,6 +9,7 @@ struct sleeplock;
 struct stat;
 struct superblock;
 struct hai_sysinfo;
+struct hai_schedinfo;
 struct hai_statfs;
 struct driver;
 struct hai_devinfo;
@@ -32,10 +33,20 @@ void            uart_driver_stats(struct hai_driver *);
 // bio.c
 void            binit(void);
 struct buf*     bread(uint, uint);
+struct buf*     bclear(uint, uint);
 void            brelse(struct buf*);
 void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
+void            bcache_stats(struct hai_statfs*);
+int             bcache_shrink(void);
+int             breadahead(uint, uint);
+int             bread_range(uint, uint, int, struct buf**);
+void            bwrite_batch(struct buf**, int);
+void            bwriteback(struct buf**, int);
+void            bsetsize(uint);
+void            bsetmeta(uint, uint);
+void            bio_async_done(struct buf*);
 
 // console.c
 void            consoleinit(void);
@@ -54,10 +65,18 @@ int             fileread(struct file*, uint64, int n);
 int             filestat(struct file*, uint64 addr);
 int             filewrite(struct file*, uint64, int n);
 
+// checksum.c
+void            csum_init(void);
+uint            adler32_update(uint, const uchar*, int);
+uint            crc32c_update(uint, const uchar*, int);
+uint            crc32c_zeros(uint, uint);
+
 // fs.c
 void            fsinit(int);
 void            fs_statfs(struct hai_statfs *);
 uint            inode_checksum(struct inode *ip);
+void            fs_committed(uint);
+int             csum_logblocks(int);
 int             dirlink(struct inode*, char*, uint);
 struct inode*   dirlookup(struct inode*, char*, uint*);
 struct inode*   ialloc(uint, short);
@@ -72,6 +91,7 @@ int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
 struct inode*   nameiparent(char*, char*);
 int             readi(struct inode*, int, uint64, uint, uint);
+int             readahead(struct inode*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, int, uint64, uint, uint);
 void            itrunc(struct inode*);
@@ -89,8 +109,14 @@ int             krefcount(uint64);
 // log.c
 void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
-void            begin_op(void);
+void            begin_op(int);
+int             log_opmax(void);
 void            end_op(void);
+void            log_stats(struct hai_statfs*);
+void            log_crash(int);
+int             log_holds(struct buf*);
+void            log_force(void);
+uint            log_opseq(void);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
@@ -119,6 +145,12 @@ int             killed(struct proc*);
 void            setkilled(struct proc*);
 int             setpriority(int pid, int prio);
 int             getpriority(int pid);
+int             setaffinity(int pid, uint64 mask);
+int             getaffinity(int pid);
+int             setclass(int pid, int cls);
+int             getclass(int pid);
+int             setdeadline(int pid, int usec);
+int             fair_weight_of(int prio);
 struct cpu*     mycpu(void);
 struct proc*    myproc();
 void            procinit(void);
@@ -126,13 +158,16 @@ void            scheduler(void) __attribute__((noreturn));
 void            sched(void);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
+void            kproc_create(char*, void (*)(void));
 int             kwait(uint64);
 void            wakeup(void*);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
-void            proc_tick(void);
+int             proc_tick(void);
+void            ipi_intr(void);
+void            sched_stats(struct hai_schedinfo *);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -174,6 +209,7 @@ void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            prepare_return(void);
+void            alarm_at(uint64, void*);
 
 // uart.c
 void            uartinit(void);
@@ -212,6 +248,9 @@ void            plic_complete(int);
 // virtio_disk.c
 void            virtio_disk_init(void);
 void            virtio_disk_rw(struct buf *, int);
+void            virtio_disk_rw_range(struct buf **, int, int);
+void            virtio_disk_rw_batch(struct buf **, int, int);
+int             virtio_disk_read_async(struct buf *);
 void            virtio_disk_intr(void);
 
 // number of elements in fixed-size array
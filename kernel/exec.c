@@ -38,7 +38,7 @@ kexec(char *path, char **argv)
   pagetable_t pagetable = 0, oldpagetable;
   struct proc *p = myproc();
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
 
   // Open the executable file.
   if((ip = namei(path)) == 0){
@@ -76,7 +76,7 @@ fileclose(struct file *f)
   if(ff.type == FD_PIPE){
     pipeclose(ff.pipe, ff.writable);
   } else if(ff.type == FD_INODE || ff.type == FD_DEVICE){
-    begin_op();
+    begin_op(MAXOPBLOCKS);
     iput(ff.ip);
     end_op();
   }
@@ -101,6 +101,36 @@ filestat(struct file *f, uint64 addr)
   return -1;
 }
 
+// Sequential readahead for f after a read that started in
+// block first and left f->off where it is now. A read that picks up
+// in the block the last one ended in, or the one after, is
+// sequential: the window doubles each time the reads move to a new
+// block. Anything else closes the window. Caller holds f->ip->lock.
+static void
+file_readahead(struct file *f, uint first)
+{
+  uint last = (f->off - 1) / BSIZE;
+
+  if(first == 0 || first == f->ra_last || first == f->ra_last + 1){
+    if(f->ra_win == 0)
+      f->ra_win = READAHEAD_MIN;
+    else if(last > f->ra_last && f->ra_win < READAHEAD_MAX)
+      f->ra_win = f->ra_win * 2 > READAHEAD_MAX ? READAHEAD_MAX : f->ra_win * 2;
+  } else {
+    f->ra_win = 0;
+    f->ra_end = 0;
+  }
+  f->ra_last = last;
+  if(f->ra_win == 0)
+    return;
+
+  uint start = last + 1, end = last + 1 + f->ra_win;
+  if(start < f->ra_end)
+    start = f->ra_end;
+  if(start < end)
+    f->ra_end = start + readahead(f->ip, start, end - start);
+}
+
 // Read from file f.
 // addr is a user virtual address.
 int
@@ -119,8 +149,11 @@ fileread(struct file *f, uint64 addr, int n)
     r = devsw[f->major].read(1, addr, n);
   } else if(f->type == FD_INODE){
     ilock(f->ip);
-    if((r = readi(f->ip, 1, addr, f->off, n)) > 0)
+    uint first = f->off / BSIZE;
+    if((r = readi(f->ip, 1, addr, f->off, n)) > 0){
       f->off += r;
+      file_readahead(f, first);
+    }
     iunlock(f->ip);
   } else {
     panic("fileread");
@@ -146,18 +179,21 @@ filewrite(struct file *f, uint64 addr, int n)
       return -1;
     ret = devsw[f->major].write(1, addr, n);
   } else if(f->type == FD_INODE){
-    // write a few blocks at a time to avoid exceeding
-    // the maximum log transaction size, including
-    // i-node, indirect block, allocation blocks,
-    // and 2 blocks of slop for non-aligned writes.
-    int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
+    // write as much per transaction as one log reservation
+    // may cover: the data blocks plus the i-node, up to two
+    // bitmap blocks, 2 blocks of slop for non-aligned writes,
+    // and the checksum table blocks for them.
+    int room = log_opmax()-1-2-2, max = room;
+    while(max > 1 && max + csum_logblocks(max + 2) > room)
+      max--;
+    max *= BSIZE;
     int i = 0;
     while(i < n){
       int n1 = n - i;
       if(n1 > max)
         n1 = max;
 
-      begin_op();
+      begin_op(n1/BSIZE + 1+2+2 + csum_logblocks(n1/BSIZE + 2));
       ilock(f->ip);
       if ((r = writei(f->ip, 1, addr + i, f->off, n1)) > 0)
         f->off += r;
@@ -170,6 +206,8 @@ filewrite(struct file *f, uint64 addr, int n)
       }
       i += r;
     }
+    if(f->sync)
+      log_force();
     ret = (i == n ? n : -1);
   } else {
     panic("filewrite");
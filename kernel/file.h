@@ -5,9 +5,13 @@ struct file {
   int ref; // reference count
   char readable;
   char writable;
+  char sync;         // O_SYNC: each write is on disk when it returns
   struct pipe *pipe; // FD_PIPE
   struct inode *ip;  // FD_INODE and FD_DEVICE
   uint off;          // FD_INODE
+  uint ra_last;      // FD_INODE: last block read, for readahead
+  uint ra_win;       // FD_INODE: readahead window in blocks, 0 if not sequential
+  uint ra_end;       // FD_INODE: blocks below this already read ahead
   short major;       // FD_DEVICE
 };
 
@@ -27,43 +27,172 @@
 struct superblock sb; 
 
 static uint bmap(struct inode *ip, uint bn);
+static uint extent_run(struct inode *ip, uint bn, uint max);
+static void fmap_init(int dev);
+static uint fmap_free(void);
+
+// The Adler-32 of n bytes d[0..n-1] is A = 1 + S and
+// B = n + n*S - T (mod 65521), where S = sum d[i] and
+// T = sum i*d[i]. S and T do not depend on n, so writei() keeps a
+// file's checksum current by taking out the old bytes it
+// overwrites and adding the new ones, never rereading the file.
+#define ADLER_MOD 65521
+
+static void
+adler32_split(uint adler, uint n, uint *s, uint *t)
+{
+  uint a = adler & 0xffff, b = (adler >> 16) & 0xffff;
+  n %= ADLER_MOD;
+  *s = (a + ADLER_MOD - 1) % ADLER_MOD;
+  *t = (uint)((n + (uint64)n * *s + ADLER_MOD - b) % ADLER_MOD);
+}
 
-// Adler-32 for block checksums
 static uint
-adler32_update(uint adler, const uchar *data, int len)
+adler32_join(uint s, uint t, uint n)
 {
-  const uint MOD_ADLER = 65521;
-  uint a = adler & 0xffff;
-  uint b = (adler >> 16) & 0xffff;
-  for(int i = 0; i < len; i++){
-    a = (a + data[i]) % MOD_ADLER;
-    b = (b + a) % MOD_ADLER;
-  }
+  n %= ADLER_MOD;
+  uint a = (1 + s) % ADLER_MOD;
+  uint b = (uint)((n + (uint64)n * s + ADLER_MOD - t) % ADLER_MOD);
   return (b << 16) | a;
 }
 
+// Add (sign > 0) or take out the len bytes p[] at file offset pos.
+static void
+adler32_delta(uint *s, uint *t, const uchar *p, uint pos, int len, int sign)
+{
+  uint64 sd = 0, sjd = 0;
+
+  for(int j = 0; j < len; j++){
+    sd += p[j];
+    sjd += (uint64)j * p[j];
+  }
+  uint ds = sd % ADLER_MOD;
+  uint dt = ((uint64)(pos % ADLER_MOD) * ds + sjd) % ADLER_MOD;
+  if(sign < 0){
+    ds = (ADLER_MOD - ds) % ADLER_MOD;
+    dt = (ADLER_MOD - dt) % ADLER_MOD;
+  }
+  *s = (*s + ds) % ADLER_MOD;
+  *t = (*t + dt) % ADLER_MOD;
+}
+
+// Running update of a file's checksum across one writei().
+// Adler-32 keeps S and T as above. For CRC32C, the difference the
+// write makes is the CRC of (old ^ new) over the overwritten range,
+// moved to the old end of the file with crc32c_zeros(); since a raw
+// CRC is linear that is raw(old) ^ raw(new). Appended bytes then
+// just continue the register.
+struct csumupd {
+  uint alg;
+  uint size;      // file size before the write
+  uint s, t;      // Adler-32
+  uint crc;       // CRC32C register over the file so far
+  uint ro, rn;    // CRC32C raw CRC of the overwritten old, new bytes
+  uint oend;      // end of the overwritten range, 0 once folded in
+};
+
+static uint
+csum_alg(void)
+{
+  return sb.checksum_alg == CSUM_CRC32C ? CSUM_CRC32C : CSUM_ADLER32;
+}
+
+// checksum of an empty file.
+static uint
+csum_empty(void)
+{
+  return csum_alg() == CSUM_CRC32C ? 0 : 1;
+}
+
+static void
+csum_begin(struct csumupd *u, struct inode *ip)
+{
+  u->alg = csum_alg();
+  u->size = ip->size;
+  if(u->alg == CSUM_CRC32C){
+    u->crc = ~ip->checksum;
+    u->ro = u->rn = u->oend = 0;
+  } else {
+    adler32_split(ip->checksum, ip->size, &u->s, &u->t);
+  }
+}
+
+static void
+csum_fold(struct csumupd *u)
+{
+  if(u->oend){
+    u->crc ^= crc32c_zeros(u->ro ^ u->rn, u->size - u->oend);
+    u->oend = 0;
+  }
+}
+
+// the len bytes p[] at pos, all below the old size, are about to be
+// overwritten.
+static void
+csum_old(struct csumupd *u, const uchar *p, uint pos, int len)
+{
+  if(u->alg != CSUM_CRC32C){
+    adler32_delta(&u->s, &u->t, p, pos, len, -1);
+  } else if(len > 0){
+    u->ro = crc32c_update(u->ro, p, len);
+    u->oend = pos + len;
+  }
+}
+
+// p[] at pos now holds len bytes; writes are in file order.
+static void
+csum_new(struct csumupd *u, const uchar *p, uint pos, int len)
+{
+  if(u->alg != CSUM_CRC32C){
+    adler32_delta(&u->s, &u->t, p, pos, len, 1);
+    return;
+  }
+  int old = pos < u->size ? min(len, u->size - pos) : 0;
+  u->rn = crc32c_update(u->rn, p, old);
+  if(len > old){
+    csum_fold(u);
+    u->crc = crc32c_update(u->crc, p + old, len - old);
+  }
+}
+
+static uint
+csum_end(struct csumupd *u, uint size)
+{
+  if(u->alg != CSUM_CRC32C)
+    return adler32_join(u->s, u->t, size);
+  csum_fold(u);
+  return ~u->crc;
+}
+
 uint
 inode_checksum(struct inode *ip)
 {
   if(ip->type != T_FILE && ip->type != T_DIR)
     return 1; // neutral checksum for non-regular files
 
+  int crc = csum_alg() == CSUM_CRC32C;
   uint blocks = (ip->size + BSIZE - 1) / BSIZE;
-  uint adler = 1; // Adler-32 init
-  for(uint bn = 0; bn < blocks; bn++){
+  uint sum = crc ? ~0 : 1;
+  struct buf *bs[MAXRANGE];
+  for(uint bn = 0; bn < blocks; ){
     uint addr = bmap(ip, bn);
     if(addr == 0)
       break;
-    struct buf *bp = bread(ip->dev, addr);
-    int chunk = BSIZE;
-    if(bn == blocks - 1){
-      uint tail = ip->size - (bn * BSIZE);
-      chunk = tail;
+    int k = bread_range(ip->dev, addr, extent_run(ip, bn, blocks - bn), bs);
+    for(int i = 0; i < k; i++, bn++){
+      int chunk = BSIZE;
+      if(bn == blocks - 1){
+        uint tail = ip->size - (bn * BSIZE);
+        chunk = tail;
+      }
+      if(crc)
+        sum = crc32c_update(sum, (uchar*)bs[i]->data, chunk);
+      else
+        sum = adler32_update(sum, (uchar*)bs[i]->data, chunk);
+      brelse(bs[i]);
     }
-    adler = adler32_update(adler, (uchar*)bp->data, chunk);
-    brelse(bp);
   }
-  return adler;
+  return crc ? ~sum : sum;
 }
 
 static void
@@ -79,24 +208,115 @@ verify_inode_checksum(struct inode *ip)
   }
 }
 
-// Read the super block.
+// Per-block checksums (DATA_CSUM_BLOCK). readi() checks a file
+// block against its sum the first time the block is used after
+// being read into the cache, and b->verified saves doing it again
+// while it stays cached, so partial and random reads are covered
+// without rereading the file. writei() stores the new sum in the
+// same transaction as the block in full journaling; in ordered
+// mode a crash between the data write and the commit leaves a
+// stale sum, reported like any other mismatch. A sum of 0 means
+// none was recorded.
+static uint64 csum_verified;
+
+static int
+block_csums(void)
+{
+  return sb.data_csum == DATA_CSUM_BLOCK && sb.csumstart != 0;
+}
+
+static uint
+block_csum(struct buf *b)
+{
+  uint sum;
+  if(csum_alg() == CSUM_CRC32C)
+    sum = ~crc32c_update(~0, b->data, BSIZE);
+  else
+    sum = adler32_update(1, b->data, BSIZE);
+  return sum ? sum : 1;
+}
+
+// Block bno's entry in the checksum table. *tb caches the table
+// block across calls; the caller brelse()s it.
+static uint*
+csum_slot(uint dev, uint bno, struct buf **tb)
+{
+  uint tbno = CSUMBLOCK(bno, sb);
+  if(*tb && (*tb)->blockno != tbno){
+    brelse(*tb);
+    *tb = 0;
+  }
+  if(*tb == 0)
+    *tb = bread(dev, tbno);
+  return (uint*)(*tb)->data + bno % CPB;
+}
+
+static void
+csum_check(struct inode *ip, struct buf *b, struct buf **tb)
+{
+  uint want = *csum_slot(ip->dev, b->blockno, tb);
+  uint got = block_csum(b);
+  if(want != 0 && want != got){
+    extern uint bio_checksum_errors;
+    bio_checksum_errors++;
+    printf("checksum mismatch: inum %d block %d expect %u got %u\n",
+           ip->inum, b->blockno, want, got);
+  }
+  b->verified = 1;
+  csum_verified++;
+}
+
+// Caller is in a transaction and has changed b.
 static void
+csum_record(struct inode *ip, struct buf *b, struct buf **tb)
+{
+  *csum_slot(ip->dev, b->blockno, tb) = block_csum(b);
+  log_write(*tb);
+  b->verified = 1;
+}
+
+// Log blocks writei() may add to a write of n data blocks for the
+// checksum table: a disk run of len blocks touches at most
+// len/CPB + 2 table blocks, and a file has at most NEXTENT runs.
+int
+csum_logblocks(int n)
+{
+  if(!block_csums())
+    return 0;
+  return min(n, n/CPB + 2*NEXTENT);
+}
+
+// Read the super block. Block 1 starts at byte BSIZE, which we
+// don't know yet: try each supported size, reading in BSIZE_MIN units.
+// Returns log2 of the block size, or -1 if there is no superblock.
+static int
 readsb(int dev, struct superblock *sb)
 {
   struct buf *bp;
 
-  bp = bread(dev, 1);
-  memmove(sb, bp->data, sizeof(*sb));
-  brelse(bp);
+  for(int exp = BSIZE_MIN_EXP; exp <= BSIZE_MAX_EXP; exp++){
+    bp = bread(dev, (1 << exp) / BSIZE_MIN);
+    memmove(sb, bp->data, sizeof(*sb));
+    brelse(bp);
+    if(sb->magic != FSMAGIC)
+      continue;
+    // images from before blocksz_exp was filled in are 1 KiB.
+    if(sb->blocksz_exp == exp || (sb->blocksz_exp == 0 && exp == BSIZE_MIN_EXP))
+      return exp;
+  }
+  return -1;
 }
 
 // Init fs
 void
 fsinit(int dev) {
-  readsb(dev, &sb);
-  if(sb.magic != FSMAGIC)
+  int exp = readsb(dev, &sb);
+  if(exp < 0)
     panic("invalid file system");
+  bsetsize(1 << exp);
+  bsetmeta(sb.inodestart, sb.size - sb.nblocks);
   initlog(dev, &sb);
+  fmap_init(dev);
   ireclaim(dev);
 }
 
@@ -108,7 +328,7 @@ void fs_statfs(struct hai_statfs *st)
   st->magic = sb.magic;
   st->version = sb.version;
   st->block_size = BSIZE;
-  st->checksum_alg = sb.checksum_alg;
+  st->checksum_alg = csum_alg();
   st->data_csum = sb.data_csum;
   st->size_blocks = sb.size;
   st->data_blocks = sb.nblocks;
@@ -119,18 +339,7 @@ void fs_statfs(struct hai_statfs *st)
   st->quota_start = sb.quota_start;
   st->quota_blocks = sb.quota_blocks;
 
-  // scan free block bitmap to compute free/used blocks
-  uint freeb = 0;
-  for(uint b = 0; b < sb.size; b += BPB){
-    struct buf *bp = bread(ROOTDEV, BBLOCK(b, sb));
-    for(uint bi = 0; bi < BPB && b + bi < sb.size; bi++){
-      int m = 1 << (bi % 8);
-      if((bp->data[bi/8] & m) == 0){
-        freeb++;
-      }
-    }
-    brelse(bp);
-  }
+  uint freeb = fmap_free();
   st->free_blocks = freeb;
   st->used_blocks = (sb.size - freeb);
 
@@ -151,82 +360,289 @@ void fs_statfs(struct hai_statfs *st)
   st->has_journaling = 1; // xv6 has metadata redo log
     st->has_checksum = 1;
   st->has_quota = 0;
+  st->journal_mode = sb.journal_mode;
 
   // pull bio counters via externs
-  extern uint bio_io_reads;
-  extern uint bio_io_writes;
   extern uint bio_checksum_errors;
-  st->io_reads = bio_io_reads;
-  st->io_writes = bio_io_writes;
   st->checksum_errors = bio_checksum_errors;
+  st->csum_verified = csum_verified;
+  bcache_stats(st);   // also io_reads/io_writes
+  log_stats(st);
 }
 
-// Zero a block.
+// Zero a block. Its old contents don't matter, so it is not read.
 static void
-bzero(int dev, int bno)
+bzero(int dev, int bno, int logged)
 {
   struct buf *bp;
 
-  bp = bread(dev, bno);
-  memset(bp->data, 0, BSIZE);
-  log_write(bp);
+  bp = bclear(dev, bno);
+  if(logged)
+    log_write(bp);
   brelse(bp);
 }
 
-// Prefer to allocate a specific block if it's free; otherwise return 0.
+// Blocks.
+//
+// fmap is an in-memory copy of the free map, built by fsinit() and
+// kept in step with the bitmap blocks by balloc_extent() and bfree().
+// A set bit in fmap.nonfull says its 64-block map word has a free
+// block, so a search skips full stretches 4096 blocks at a time and
+// its cost stays flat as the disk fills; the bitmap blocks are only
+// read to be updated.
+//
+// A freed block stays in use in fmap until the transaction that
+// freed it has committed: until then a crash brings back the file
+// that held it, and in ordered mode writei() would already have
+// written another file's data over it. bfree() notes the block in
+// fmap.pend[] for its transaction, and fs_committed() hands the
+// blocks back. Only the open and the committing transaction can
+// have pending frees, so two sets, by sequence parity, suffice.
+#define FMAP_WPP (PGSIZE / sizeof(uint64))  // map words per page
+
+struct {
+  struct spinlock lock;
+  uint64 *map[FMAP_PAGES];  // bit set: block in use
+  uint64 nonfull[FMAP_PAGES * FMAP_WPP / 64];
+  uint64 *pend[2][FMAP_PAGES]; // bit set: freed by a transaction not yet on disk
+  uint npend[2];
+  uint nwords;
+  uint nfree;
+  uint rotor;               // where a search with no hint starts
+} fmap;
+
+static int
+ctz64(uint64 x)
+{
+  int n = 0;
+  if((x & 0xffffffff) == 0){ n += 32; x >>= 32; }
+  if((x & 0xffff) == 0){ n += 16; x >>= 16; }
+  if((x & 0xff) == 0){ n += 8; x >>= 8; }
+  if((x & 0xf) == 0){ n += 4; x >>= 4; }
+  if((x & 0x3) == 0){ n += 2; x >>= 2; }
+  if((x & 0x1) == 0)
+    n += 1;
+  return n;
+}
+
+static uint64*
+fmap_word(uint w)
+{
+  return &fmap.map[w / FMAP_WPP][w % FMAP_WPP];
+}
+
+static void
+fmap_sync(uint w)
+{
+  if(*fmap_word(w) == ~0UL)
+    fmap.nonfull[w / 64] &= ~(1UL << (w % 64));
+  else
+    fmap.nonfull[w / 64] |= 1UL << (w % 64);
+}
+
+static uint64*
+fmap_pend(int g, uint w)
+{
+  return &fmap.pend[g][w / FMAP_WPP][w % FMAP_WPP];
+}
+
+// Mark blocks b..b+n-1 in use. Caller holds fmap.lock.
+static void
+fmap_take(uint b, uint n)
+{
+  for(uint i = b; i < b + n; i++){
+    *fmap_word(i / 64) |= 1UL << (i % 64);
+    if(i % 64 == 63 || i == b + n - 1)
+      fmap_sync(i / 64);
+  }
+  fmap.nfree -= n;
+}
+
+// First free block at or after b, or sb.size if there is none.
 static uint
-balloc_prefer(uint dev, uint b)
+fmap_next_free(uint b)
 {
   if(b >= sb.size)
-    return 0;
+    return sb.size;
+  uint w = b / 64;
+  uint64 free = ~*fmap_word(w) & (~0UL << (b % 64));
+  if(free)
+    return w * 64 + ctz64(free);
+  for(w++; w < fmap.nwords; ){
+    uint64 s = fmap.nonfull[w / 64] >> (w % 64);
+    if(s == 0){
+      w = (w / 64 + 1) * 64;
+      continue;
+    }
+    w += ctz64(s);
+    return w * 64 + ctz64(~*fmap_word(w));
+  }
+  return sb.size;
+}
 
-  struct buf *bp = bread(dev, BBLOCK(b, sb));
-  int bi = b % BPB;
-  int m = 1 << (bi % 8);
-  if((bp->data[bi/8] & m) != 0){
-    brelse(bp);
-    return 0; // already allocated
+// Number of free blocks, at most max, starting with free block b.
+static uint
+fmap_run(uint b, uint max)
+{
+  uint n = 0;
+  while(n < max){
+    uint i = b + n;
+    uint64 used = *fmap_word(i / 64) >> (i % 64);
+    if(used){
+      n += ctz64(used);
+      break;
+    }
+    n += 64 - i % 64;
+    if(i / 64 + 1 >= fmap.nwords)
+      break;
   }
+  return n < max ? n : max;
+}
 
-  // mark allocated
-  bp->data[bi/8] |= m;
-  log_write(bp);
-  brelse(bp);
+// Build fmap from the bitmap blocks. Map bits past the end of the
+// disk stay set, so nothing there is ever allocated.
+static void
+fmap_init(int dev)
+{
+  initlock(&fmap.lock, "fmap");
+  fmap.nwords = (sb.size + 63) / 64;
+  if(fmap.nwords > FMAP_PAGES * FMAP_WPP)
+    panic("fmap: file system too large");
+  for(uint p = 0; p * FMAP_WPP < fmap.nwords; p++){
+    if((fmap.map[p] = kalloc()) == 0)
+      panic("fmap: kalloc");
+    memset(fmap.map[p], 0xff, PGSIZE);
+    for(int g = 0; g < 2; g++){
+      if((fmap.pend[g][p] = kalloc()) == 0)
+        panic("fmap: kalloc");
+      memset(fmap.pend[g][p], 0, PGSIZE);
+    }
+  }
+  fmap.nfree = 0;
+  for(uint b = 0; b < sb.size; b += BPB){
+    struct buf *bp = bread(dev, BBLOCK(b, sb));
+    for(uint bi = 0; bi < BPB && b + bi < sb.size; bi++){
+      if((bp->data[bi/8] & (1 << (bi % 8))) == 0){
+        *fmap_word((b + bi) / 64) &= ~(1UL << ((b + bi) % 64));
+        fmap.nfree++;
+      }
+    }
+    brelse(bp);
+  }
+  for(uint w = 0; w < fmap.nwords; w++)
+    fmap_sync(w);
+  fmap.rotor = sb.size - sb.nblocks;  // first data block
+}
 
-  bzero(dev, b);
-  return b;
+// Free blocks, counting those whose free has not committed yet.
+static uint
+fmap_free(void)
+{
+  acquire(&fmap.lock);
+  uint n = fmap.nfree + fmap.npend[0] + fmap.npend[1];
+  release(&fmap.lock);
+  return n;
 }
 
-// Blocks.
+// Transaction seq is on disk: the blocks it freed may be reused.
+// Called by the log with log.lock held.
+void
+fs_committed(uint seq)
+{
+  int g = seq % 2;
+
+  acquire(&fmap.lock);
+  if(fmap.npend[g]){
+    for(uint w = 0; w < fmap.nwords; w++){
+      uint64 *p = fmap_pend(g, w);
+      if(*p){
+        *fmap_word(w) &= ~*p;
+        *p = 0;
+        fmap_sync(w);
+      }
+    }
+    fmap.nfree += fmap.npend[g];
+    fmap.npend[g] = 0;
+  }
+  release(&fmap.lock);
+}
 
-// Allocate a zeroed disk block.
-// returns 0 if out of disk space.
+// Allocate a run of up to n contiguous zeroed blocks: at hint if
+// that block is free, so that a file's last extent can grow in
+// place, else the first run of n free blocks found searching on from
+// hint (or from where the last search left off if hint is 0), else
+// the longest of the first BALLOC_SCAN_RUNS shorter runs. Sets *len
+// to the length of the run. Unless logged, the blocks are zeroed
+// only in the cache: see ordered_data().
+// Returns the first block, or 0 if out of disk space.
 static uint
-balloc(uint dev)
+balloc_extent(uint dev, uint hint, uint n, uint *len, int logged)
 {
-  int b, bi, m;
+  uint b, got, best = 0, bestlen = 0;
   struct buf *bp;
 
+  acquire(&fmap.lock);
+  if(hint == 0 || hint >= sb.size)
+    hint = fmap.rotor;
+  b = fmap_next_free(hint);
+  if(b == hint){
+    best = b;
+    bestlen = fmap_run(b, n);
+  } else {
+    int wrapped = 0;
+    for(int tries = 0; tries < BALLOC_SCAN_RUNS; ){
+      if(b >= sb.size || (wrapped && b >= hint)){
+        if(wrapped)
+          break;
+        wrapped = 1;
+        b = fmap_next_free(0);
+        continue;
+      }
+      got = fmap_run(b, n);
+      if(got > bestlen){
+        best = b;
+        bestlen = got;
+      }
+      if(got == n)
+        break;
+      b = fmap_next_free(b + got);
+      tries++;
+    }
+  }
+  if(bestlen == 0){
+    release(&fmap.lock);
+    printf("balloc: out of blocks\n");
+    return 0;
+  }
+  fmap_take(best, bestlen);
+  fmap.rotor = best + bestlen;
+  release(&fmap.lock);
+
   bp = 0;
-  for(b = 0; b < sb.size; b += BPB){
-    bp = bread(dev, BBLOCK(b, sb));
-    for(bi = 0; bi < BPB && b + bi < sb.size; bi++){
-      m = 1 << (bi % 8);
-      if((bp->data[bi/8] & m) == 0){  // Is block free?
-        bp->data[bi/8] |= m;  // Mark block in use.
+  for(b = best; b < best + bestlen; b++){
+    if(bp == 0 || bp->blockno != BBLOCK(b, sb)){
+      if(bp){
         log_write(bp);
         brelse(bp);
-        bzero(dev, b + bi);
-        return b + bi;
       }
+      bp = bread(dev, BBLOCK(b, sb));
     }
-    brelse(bp);
+    int bi = b % BPB;
+    int m = 1 << (bi % 8);
+    if(bp->data[bi/8] & m)
+      panic("balloc: free map out of step");
+    bp->data[bi/8] |= m;  // Mark block in use.
   }
-  printf("balloc: out of blocks\n");
-  return 0;
+  log_write(bp);
+  brelse(bp);
+  for(b = best; b < best + bestlen; b++)
+    bzero(dev, b, logged);
+  *len = bestlen;
+  return best;
 }
 
-// Free a disk block.
+// Free a disk block. It becomes allocatable once the calling
+// system call's transaction has committed.
 static void
 bfree(int dev, uint b)
 {
@@ -241,6 +657,13 @@ bfree(int dev, uint b)
   bp->data[bi/8] &= ~m;
   log_write(bp);
   brelse(bp);
+
+  // the transaction can't close while this system call is in it.
+  int g = log_opseq() % 2;
+  acquire(&fmap.lock);
+  *fmap_pend(g, b / 64) |= 1UL << (b % 64);
+  fmap.npend[g]++;
+  release(&fmap.lock);
 }
 
 // Inodes.
@@ -347,7 +770,7 @@ ialloc(uint dev, short type)
     if(dip->type == 0){  // a free inode
       memset(dip, 0, sizeof(*dip));
       dip->type = type;
-      dip->checksum = 1; // Adler-32 neutral for empty
+      dip->checksum = csum_empty();
       log_write(bp);   // mark it allocated on the disk
       brelse(bp);
       return iget(dev, inum);
@@ -527,7 +950,7 @@ ireclaim(int dev)
     }
     brelse(bp);
     if (ip) {
-      begin_op();
+      begin_op(MAXOPBLOCKS);
       ilock(ip);
       iunlock(ip);
       iput(ip);
@@ -538,29 +961,34 @@ ireclaim(int dev)
 
 // Inode content (Hai-OS FSv2): extent-based layout.
 
-// Append a physical block into inode's extent list, merging if contiguous.
+// Append the len physical blocks at start to ip's extent list,
+// growing the last extent if they continue it.
 static int
-extent_append(struct inode *ip, uint newb)
+extent_append(struct inode *ip, uint start, uint len)
 {
-  for(int i = 0; i < NEXTENT; i++){
-    if(ip->extents[i].len == 0){
-      ip->extents[i].start = newb;
-      ip->extents[i].len = 1;
-      return 0;
-    }
-  }
-  // try to extend last non-empty if contiguous
-  for(int i = NEXTENT-1; i >= 0; i--){
-    if(ip->extents[i].len){
-      uint tail = ip->extents[i].start + ip->extents[i].len;
-      if(tail == newb){
-        ip->extents[i].len += 1;
-        return 0;
-      }
-      break;
-    }
+  int i;
+
+  for(i = 0; i < NEXTENT && ip->extents[i].len; i++)
+    ;
+  if(i > 0 && ip->extents[i-1].start + ip->extents[i-1].len == start){
+    ip->extents[i-1].len += len;
+    return 0;
   }
-  return -1;
+  if(i == NEXTENT)
+    return -1;
+  ip->extents[i].start = start;
+  ip->extents[i].len = len;
+  return 0;
+}
+
+// In ordered mode a regular file's data blocks skip the log:
+// writei() writes them home before the transaction that maps
+// them commits, so only inode, bitmap and directory blocks are
+// logged.
+static int
+ordered_data(struct inode *ip)
+{
+  return sb.journal_mode == JOURNAL_ORDERED && ip->type == T_FILE;
 }
 
 // Map logical block number bn to physical block, allocating as needed.
@@ -568,6 +996,7 @@ static uint
 bmap(struct inode *ip, uint bn)
 {
   uint logical_base = 0;
+  int logged = !ordered_data(ip);
   uint last_start = 0, last_len = 0;
 
   // find existing extent covering bn
@@ -583,31 +1012,29 @@ bmap(struct inode *ip, uint bn)
     logical_base += len;
   }
 
-  // allocate forward until we reach bn
+  // allocate everything up to bn, in as few runs as the free map
+  // allows, each continuing the last extent if it can.
+  uint nb = 0, got = 0;
   while(logical_base <= bn){
-    uint nb = 0;
-    // try to stay contiguous with last extent to avoid overflow
-    if(last_len > 0)
-      nb = balloc_prefer(ip->dev, last_start + last_len);
-    if(nb == 0)
-      nb = balloc(ip->dev);
+    uint hint = last_len ? last_start + last_len : 0;
+    nb = balloc_extent(ip->dev, hint, bn - logical_base + 1, &got, logged);
     if(nb == 0)
       return 0;
-    if(extent_append(ip, nb) < 0)
-      panic("bmap: extent overflow");
-    last_start = nb; // extent_append merges when contiguous
-    if(ip->extents[0].len)
-      last_len = ip->extents[0].len; // updated after append; recompute tail
-    for(int i = 0; i < NEXTENT; i++){
-      if(ip->extents[i].len)
-        last_len = ip->extents[i].len, last_start = ip->extents[i].start;
+    if(extent_append(ip, nb, got) < 0){
+      // the file can't take another extent.
+      for(uint i = 0; i < got; i++)
+        bfree(ip->dev, nb + i);
+      return 0;
+    }
+    if(last_len && nb == hint){
+      last_len += got;
+    } else {
+      last_start = nb;
+      last_len = got;
     }
-    if(logical_base == bn)
-      return nb;
-    logical_base++;
+    logical_base += got;
   }
-
-  panic("bmap: unreachable");
+  return nb + got - (logical_base - bn);
 }
 
 // Truncate inode (discard contents).
@@ -625,7 +1052,7 @@ itrunc(struct inode *ip)
     ip->extents[i].len = 0;
   }
   ip->size = 0;
-  ip->checksum = 1;
+  ip->checksum = csum_empty();
   ip->cache.valid = 0;
   ip->cache.truncated = 0;
   ip->cache.nentries = 0;
@@ -652,34 +1079,102 @@ int
 readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
 {
   uint tot, m;
-  struct buf *bp;
+  struct buf *bs[MAXRANGE], *tb = 0;
   uint start_off = off;
+  int bcs = block_csums() && (ip->type == T_FILE || ip->type == T_DIR);
 
   if(off > ip->size || off + n < off)
     return 0;
   if(off + n > ip->size)
     n = ip->size - off;
 
-  for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
-    uint addr = bmap(ip, off/BSIZE);
+  // read each contiguous run of blocks with one bread_range().
+  for(tot=0; tot<n; ){
+    uint bn = off/BSIZE;
+    uint addr = bmap(ip, bn);
     if(addr == 0)
       break;
-    bp = bread(ip->dev, addr);
-    m = min(n - tot, BSIZE - off%BSIZE);
-    if(either_copyout(user_dst, dst, bp->data + (off % BSIZE), m) == -1) {
-      brelse(bp);
+    int k = bread_range(ip->dev, addr,
+                        extent_run(ip, bn, (off + n - tot - 1)/BSIZE - bn + 1), bs);
+    int i, err = 0;
+    for(i = 0; i < k; i++){
+      if(bcs && !bs[i]->verified)
+        csum_check(ip, bs[i], &tb);
+      m = min(n - tot, BSIZE - off%BSIZE);
+      if(!err && either_copyout(user_dst, dst, bs[i]->data + (off % BSIZE), m) == -1)
+        err = 1;
+      tot += m; off += m; dst += m;
+      brelse(bs[i]);
+    }
+    if(err){
       tot = -1;
       break;
     }
-    brelse(bp);
   }
 
-  // If the caller read the whole file from the beginning, verify checksum.
-  if(start_off == 0 && tot == ip->size)
+  if(tb)
+    brelse(tb);
+  // without block sums, check the file's sum after a whole-file read.
+  if(!bcs && start_off == 0 && tot == ip->size)
     verify_inode_checksum(ip);
   return tot;
 }
 
+// Number of blocks, at most max, that are contiguous on disk
+// starting with file block bn, which must be mapped.
+static uint
+extent_run(struct inode *ip, uint bn, uint max)
+{
+  uint logical_base = 0;
+
+  for(int i = 0; i < NEXTENT; i++){
+    uint len = ip->extents[i].len;
+    if(len == 0)
+      continue;
+    if(bn < logical_base + len){
+      uint run = logical_base + len - bn;
+      return run < max ? run : max;
+    }
+    logical_base += len;
+  }
+  return 1;
+}
+
+// Start asynchronous reads of up to n blocks of ip beginning at
+// file block bn, without going past the end of the file or of the
+// extent that holds bn. Caller must hold ip->lock.
+// Returns the number of blocks dealt with (started or already cached).
+int
+readahead(struct inode *ip, uint bn, uint n)
+{
+  uint logical_base = 0, nblocks, i;
+
+  if(ip->type != T_FILE)
+    return 0;
+  nblocks = (ip->size + BSIZE - 1) / BSIZE;
+  if(bn >= nblocks)
+    return 0;
+  if(n > nblocks - bn)
+    n = nblocks - bn;
+
+  for(i = 0; i < NEXTENT; i++){
+    struct extent *e = &ip->extents[i];
+    if(e->len == 0)
+      continue;
+    if(bn < logical_base + e->len){
+      uint k, off = bn - logical_base;
+      if(n > e->len - off)
+        n = e->len - off;
+      for(k = 0; k < n; k++)
+        if(breadahead(ip->dev, e->start + off + k) < 0)
+          break;
+      return k;
+    }
+    logical_base += e->len;
+  }
+  return 0;
+}
+
 // Write data to inode.
 // Caller must hold ip->lock.
 // If user_src==1, then src is a user virtual address;
@@ -691,38 +1186,84 @@ int
 writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
 {
   uint tot, m;
-  struct buf *bp;
+  struct buf *bs[MAXRANGE];
 
   if(off > ip->size || off + n < off)
     return -1;
   if(off + n > MAXFILE*BSIZE)
     return -1;
 
-  for(tot=0; tot<n; tot+=m, off+=m, src+=m){
-    uint addr = bmap(ip, off/BSIZE);
+  // allocate the whole range first so that it can be read in runs.
+  if(n > 0)
+    bmap(ip, (off + n - 1)/BSIZE);
+
+  int ordered = ordered_data(ip);
+  int csum = ip->type == T_FILE || ip->type == T_DIR;
+  int bcs = csum && block_csums();
+  struct buf *tb = 0;
+  struct csumupd cu;
+  if(csum)
+    csum_begin(&cu, ip);
+  for(tot=0; tot<n; ){
+    uint bn = off/BSIZE;
+    uint addr = bmap(ip, bn);
     if(addr == 0)
       break;
-    bp = bread(ip->dev, addr);
-    m = min(n - tot, BSIZE - off%BSIZE);
-    if(either_copyin(bp->data + (off % BSIZE), user_src, src, m) == -1) {
-      brelse(bp);
-      break;
+    int k = bread_range(ip->dev, addr,
+                        extent_run(ip, bn, (off + n - tot - 1)/BSIZE - bn + 1), bs);
+    struct buf *home[MAXRANGE];
+    int i, nhome = 0, err = 0;
+    for(i = 0; i < k; i++){
+      if(!err){
+        m = min(n - tot, BSIZE - off%BSIZE);
+        uchar *p = bs[i]->data + (off % BSIZE);
+        int old = off < ip->size ? min(m, ip->size - off) : 0;
+        // the rest of a partly overwritten block gets the new sum.
+        if(bcs && !bs[i]->verified && m < BSIZE && off - off%BSIZE < ip->size)
+          csum_check(ip, bs[i], &tb);
+        if(csum)
+          csum_old(&cu, p, off, old);
+        if(either_copyin(p, user_src, src, m) == -1){
+          if(csum)
+            csum_new(&cu, p, off, old);
+          err = 1;
+        } else {
+          if(csum)
+            csum_new(&cu, p, off, m);
+          if(bcs)
+            csum_record(ip, bs[i], &tb);
+          // a block the log still holds must stay logged, or a
+          // checkpoint would overwrite it with the older copy.
+          if(ordered && !log_holds(bs[i]))
+            home[nhome++] = bs[i];
+          else
+            log_write(bs[i]);
+          tot += m; off += m; src += m;
+        }
+      }
     }
-    log_write(bp);
-    brelse(bp);
+    // ordered data: on disk before the transaction that maps it commits.
+    if(nhome > 0)
+      bwrite_batch(home, nhome);
+    for(i = 0; i < k; i++)
+      brelse(bs[i]);
+    if(err)
+      break;
   }
 
+  if(tb)
+    brelse(tb);
   if(off > ip->size)
     ip->size = off;
 
-  // directory writes invalidate cache; file writes recompute checksum
+  // directory writes invalidate cache; file writes update the checksum
   if(ip->type == T_DIR){
     ip->cache.valid = 0;
     ip->cache.truncated = 0;
     ip->cache.nentries = 0;
   }
-  if(ip->type == T_FILE || ip->type == T_DIR)
-    ip->checksum = inode_checksum(ip);
+  if(csum)
+    ip->checksum = csum_end(&cu, ip->size);
 
   // write the i-node back to disk even if the size didn't change
   // because the loop above might have called bmap() and added a new
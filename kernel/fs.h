@@ -5,7 +5,21 @@
 #define HAI_FS_H
 
 #define ROOTINO  1   // root i-number
-#define BSIZE 1024  // block size (keep 1KB for now)
+// Block size. The superblock records it as blocksz_exp, and the
+// kernel uses whatever the mounted file system says (fs_bsize, set
+// by fsinit). mkfs and user programs see the compile-time default;
+// build mkfs with -DBSIZE_DEFAULT=4096 for a 4 KiB image.
+#define BSIZE_MIN 1024
+#define BSIZE_MAX 4096
+#ifndef BSIZE_DEFAULT
+#define BSIZE_DEFAULT 1024
+#endif
+#ifdef HAI_KERNEL
+extern uint fs_bsize;
+#define BSIZE fs_bsize
+#else
+#define BSIZE BSIZE_DEFAULT
+#endif
 
 // Disk layout:
 // [ boot block | super block | log | inode blocks |
@@ -25,15 +39,53 @@ struct superblock {
   uint inodestart;   // First inode block
   uint bmapstart;    // First free map block
   uint blocksz_exp;  // log2(block size)
-  uint checksum_alg; // 0 none, 1 adler32 (planned)
-  uint data_csum;    // 0 none, 1 per-file checksum enabled
+  uint checksum_alg; // file checksums: CSUM_ADLER32 or CSUM_CRC32C
+  uint data_csum;    // DATA_CSUM_FILE or DATA_CSUM_BLOCK
   uint log_segments; // journaling segments (nlog currently)
   uint quota_start;  // reserved for quota table start
   uint quota_blocks; // reserved blocks for quota
+  uint journal_mode; // JOURNAL_FULL or JOURNAL_ORDERED
+  uint commit_ticks; // 0: end_op() waits for its commit; else lazy, see log.c
+  uint csumstart;    // first block of the per-block checksum table
 };
 
+// Journaling modes (superblock journal_mode).
+#define JOURNAL_FULL    0  // file data goes through the log too
+#define JOURNAL_ORDERED 1  // file data goes home before the metadata commits
+#ifndef JOURNAL_MODE_DEFAULT
+#define JOURNAL_MODE_DEFAULT JOURNAL_FULL  // what mkfs writes
+#endif
+#ifndef COMMIT_TICKS_DEFAULT
+#define COMMIT_TICKS_DEFAULT 0             // what mkfs writes
+#endif
+
+// File checksum algorithms (superblock checksum_alg); 0 from older
+// images means Adler-32.
+#define CSUM_ADLER32 1
+#define CSUM_CRC32C  2
+#ifndef CHECKSUM_ALG_DEFAULT
+#define CHECKSUM_ALG_DEFAULT CSUM_ADLER32  // what mkfs writes
+#endif
+
+// File data checksums (superblock data_csum). DATA_CSUM_BLOCK keeps
+// one sum per disk block in CSUMBLOCKS blocks at csumstart, after
+// the free map; mkfs fills it in for the files it writes.
+#define DATA_CSUM_FILE  1  // a whole-file sum in each inode
+#define DATA_CSUM_BLOCK 2  // that, and a sum per block, see fs.c
+#define CPB           (BSIZE / sizeof(uint))
+#define CSUMBLOCKS(sb) (((sb).size + CPB - 1) / CPB)
+#define CSUMBLOCK(b, sb) ((b)/CPB + sb.csumstart)  // table block for block b
+#ifndef DATA_CSUM_DEFAULT
+#define DATA_CSUM_DEFAULT DATA_CSUM_FILE  // what mkfs writes
+#endif
+
 #define FSMAGIC 0x48414946  // 'HAIF' Hai-OS FSv2
 
+// The superblock is block 1, so its byte offset is the block size:
+// fsinit() looks for it at each supported size in turn.
+#define BSIZE_MIN_EXP 10
+#define BSIZE_MAX_EXP 12
+
 // Extent-based layout
 #define NEXTENT   14  // 14 extents keeps dinode size aligned (1024 % (16+8*N)==0)
 struct extent {
@@ -83,13 +135,19 @@ struct dirent {
 };
 
 
+// logcrash() points, for the log crash tests in test-xv6.py.
+#define LOGCRASH_TORN    1  // stop after writing part of a commit
+#define LOGCRASH_COMMIT  2  // stop once a commit is on disk
+#define LOGCRASH_INSTALL 3  // stop after a checkpoint's home writes, before the header
+
 // Hai-OS filesystem telemetry (Stage 6 scaffolding)
+#define LOG_LAT_BUCKETS 8  // commit latency by transaction size, powers of 2
 struct hai_statfs {
   uint magic;           // FSMAGIC
   uint version;         // FS layout version
   uint block_size;      // in bytes
-  uint checksum_alg;    // 0 none, 1 adler32 (reserved)
-  uint data_csum;       // 0 none, 1 per-file checksum
+  uint checksum_alg;    // CSUM_ADLER32 or CSUM_CRC32C
+  uint data_csum;       // DATA_CSUM_FILE or DATA_CSUM_BLOCK
   uint size_blocks;     // total blocks in image
   uint data_blocks;     // number of data blocks
   uint inode_count;     // total inodes
@@ -102,11 +160,13 @@ struct hai_statfs {
   uint io_reads;
   uint io_writes;
   uint checksum_errors; // runtime checksum verification failures (placeholder)
+  uint64 csum_verified; // file blocks checked against their sum on cache fill
 
   // journaling/checksum/quota flags (placeholders for future Stage 6)
   uint has_journaling;  // 0/1
   uint has_checksum;    // 0/1
   uint has_quota;       // 0/1
+  uint journal_mode;    // JOURNAL_FULL or JOURNAL_ORDERED
 
   // log head/tail (placeholders, exposed by log.c)
   uint log_start;       // first log block
@@ -114,6 +174,46 @@ struct hai_statfs {
   uint log_segments;    // journaling segments
   uint quota_start;     // quota table start (reserved)
   uint quota_blocks;    // quota table length (reserved)
+  uint log_pending;     // committed log blocks not yet installed
+  uint64 log_commits;     // transactions committed
+  uint64 log_checkpoints; // checkpointer passes
+  uint64 log_installed;   // home blocks written by the checkpointer
+  uint64 log_superseded;  // committed blocks skipped, rewritten later in the log
+  uint64 log_space_waits; // begin_op() waits for log space
+  uint64 log_commit_blocks; // blocks written by those commits
+  uint64 log_ops;           // end_op() calls, batched into the commits
+  uint log_commits_per_sec; // over the last second with commits
+  uint log_blocks_per_commit; // log_commit_blocks / log_commits
+  uint64 log_writes;        // log_write() calls
+  uint64 log_absorbed;      // of those, blocks already in the open transaction
+  uint64 log_forces;        // fsync/fdatasync calls and O_SYNC writes
+  uint log_lazy_ticks;      // superblock commit_ticks, 0 if every end_op() commits
+  uint64 log_lat_commits[LOG_LAT_BUCKETS]; // commits of 1, 2-3, 4-7, ... 128+ blocks
+  uint64 log_lat_us[LOG_LAT_BUCKETS];      // their total commit latency, in us
+
+  // buffer cache (bio.c)
+  uint bcache_nbuf;     // buffers
+  uint bcache_buckets;  // hash buckets
+  uint64 bcache_lookups;    // bget() calls, i.e. hits + misses
+  uint64 bcache_searches;   // hash chain searches (a miss searches twice)
+  uint64 bcache_chain_steps; // buffers examined by those searches
+  uint64 bcache_lock_acquires; // bucket + eviction lock acquisitions
+  uint64 bcache_lock_spins;    // failed attempts spinning on them
+  uint bcache_maxbuf;   // growth limit (BCACHE_MAX_PCT of RAM)
+  uint64 bcache_hits;   // lookups that found the block cached
+  uint64 bcache_misses; // lookups that had to fill a buffer
+  uint64 bcache_grows;  // buffer groups added
+  uint64 bcache_shrinks; // buffer groups returned under memory pressure
+  uint64 bcache_ra_issued; // readahead reads started
+  uint64 bcache_ra_hits;   // readahead blocks later read
+  uint64 bcache_ra_waste;  // readahead blocks evicted unread
+  uint64 bcache_evictions;  // cached blocks dropped for reuse or shrink
+  uint64 bcache_writebacks; // logged blocks installed at home by the checkpointer
+  uint64 bcache_dev_reads;  // blocks read from the disk
+  uint64 bcache_dev_writes; // blocks written to the disk
+  uint64 bcache_meta_lookups; // lookups of inode and bitmap blocks
+  uint64 bcache_meta_hits;    // of those, hits
+  uint64 bcache_promotions;   // buffers promoted from probation to hot
 };
 
 #endif // HAI_FS_H
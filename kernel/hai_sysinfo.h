@@ -11,9 +11,21 @@ struct hai_sysinfo {
   int    log_level;      // 当前内核日志等级
 };
 
-#define HAI_MAX_PROCSNAPSHOT 32
+#define HAI_MAX_HARTS 8  // hai_schedinfo.harts 的容量，须不小于内核 NCPU（见 proc.c）
 
-// 进程快照信息，用于 top/ps 等工具。
+// wakeup/runnable 到开始运行的延迟直方图：第 i 桶统计延迟
+// < HAI_LAT_BASE_CYCLES << (2*i) 个 time 周期，最后一桶不设上限。
+#define HAI_LAT_BUCKETS     8
+#define HAI_LAT_BASE_CYCLES 1000  // ~100us at qemu virt's 10MHz timebase
+
+// 调度类：MLFQ 按优先级并随唤醒/耗尽时间片动态调整；FAIR 按
+// vruntime（按权重折算的 CPU 周期）分配，权重由 setpriority 级别决定；
+// RT 为实时 FIFO，优先于前两类，优先级固定，受 SCHED_RT_RUNTIME 节流。
+#define HAI_SCHED_MLFQ 0
+#define HAI_SCHED_FAIR 1
+#define HAI_SCHED_RT   2
+
+// 进程快照信息，用于 top/ps 等工具；由 procsnap() 按游标分批返回。
 struct hai_procinfo {
   int pid;
   int state;
@@ -21,9 +33,32 @@ struct hai_procinfo {
   uint64 rtime;
   uint64 sched_cnt;
   uint64 page_faults;
+  uint64 nvcsw;         // voluntary context switches
+  uint64 nivcsw;        // involuntary context switches
+  uint64 affinity;      // allowed harts mask
+  uint64 migrations;    // hart-to-hart moves
+  int last_cpu;         // hart it last ran on, -1 if never
+  int sched_class;      // HAI_SCHED_MLFQ, HAI_SCHED_FAIR or HAI_SCHED_RT
+  int weight;           // fair-share weight of its priority (1024 = default)
+  uint64 vruntime;      // weighted CPU time in time-base cycles (FAIR)
+  uint64 cputime;       // CPU time in time-base cycles
+  uint64 rundelay[HAI_LAT_BUCKETS]; // RUNNABLE-to-RUNNING delay histogram
+  uint64 rundelay_sum;  // total cycles spent RUNNABLE
+  uint64 rundelay_max;  // longest single wait, in cycles
+  uint64 deadline;      // run-delay bound in cycles, 0 = none
+  uint64 deadline_misses; // dispatches later than deadline
   char name[16];
 };
 
+// 每个 hart 的调度统计。
+struct hai_hartstat {
+  int online;           // running scheduler()
+  uint64 nswitch;       // processes dispatched
+  uint64 idle_cycles;   // cycles spent in wfi with nothing to run
+  uint64 total_cycles;  // cycles since the hart entered scheduler()
+  uint64 rt_throttled;  // RT periods cut short by SCHED_RT_RUNTIME
+};
+
 struct hai_schedinfo {
   int runnable;
   int running;
@@ -31,8 +66,17 @@ struct hai_schedinfo {
   int zombies;
   int used;
   uint64 ticks;
-  int nreturned;
-  struct hai_procinfo procs[HAI_MAX_PROCSNAPSHOT];
+  uint64 wakelat[HAI_LAT_BUCKETS]; // wakeup-to-run latency histogram
+  uint64 ipi_sent;      // reschedule IPIs sent by wakeup()
+  uint64 ipi_recv;      // reschedule IPIs taken
+  uint64 migrations;    // dispatches away from a process's last hart
+  int nfair;            // live processes in the fair-share class
+  uint64 min_vruntime;  // fair-share clock new/waking processes start from
+  uint64 vruntime_spread; // max - min vruntime of runnable fair processes
+  int nrt;              // live processes in the real-time class
+  uint64 rt_throttled;  // RT throttle events, all harts
+  uint64 deadline_misses; // dispatches later than the process's deadline
+  struct hai_hartstat harts[HAI_MAX_HARTS];
 };
 
 struct hai_vmstat {
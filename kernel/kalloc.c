@@ -115,7 +115,9 @@ kalloc(void)
 {
   struct run *r;
   int idx = -1;
+  int retried = 0;
 
+again:
   acquire(&kmem.lock);
   r = kmem.freelist;
   if(r){
@@ -127,6 +129,14 @@ kalloc(void)
     kmem.free_pages--;
   release(&kmem.lock);
 
+  // 内存紧张时让缓冲区缓存归还空闲页；分配失败则回收后重试一次。
+  if(!r && !retried && bcache_shrink() > 0){
+    retried = 1;
+    goto again;
+  }
+  if(r && kmem.free_pages <= MEM_LOW_WATERMARK_PAGES)
+    bcache_shrink();
+
   if(r)
     memset((char*)r, 5, PGSIZE); // fill with junk
 
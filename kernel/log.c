@@ -4,208 +4,678 @@
 #include "param.h"
 #include "spinlock.h"
 #include "sleeplock.h"
+#include "proc.h"
 #include "fs.h"
 #include "buf.h"
 
 // Simple logging that allows concurrent FS system calls.
 //
 // A log transaction contains the updates of multiple FS system
-// calls. The logging system only commits when there are
-// no FS system calls active. Thus there is never
+// calls. The logging system only closes a transaction when there
+// are no FS system calls active in it. Thus there is never
 // any reasoning required about whether a commit might
 // write an uncommitted system call's updates to disk.
 //
-// A system call should call begin_op()/end_op() to mark
-// its start and end. Usually begin_op() just increments
-// the count of in-progress FS system calls and returns.
-// But if it thinks the log is close to running out, it
-// sleeps until the last outstanding end_op() commits.
+// A system call should call begin_op(n)/end_op() to mark
+// its start and end, where n bounds the distinct blocks it will
+// log. Usually begin_op() just adds n to the space reserved by
+// in-progress FS system calls and returns. But if the log could
+// run out, it sleeps until the checkpointer has freed enough
+// log space. A big write reserves what it needs, so it commits
+// in a few large transactions rather than many small ones.
+//
+// With a lazy superblock (commit_ticks > 0), end_op() does not wait:
+// the logcommit process commits the open transaction once it is
+// commit_ticks old, end_op() commits once it fills a quarter of the
+// ring, and fsync() (log_force()) commits at once. A crash loses at
+// most the last commit_ticks of updates, never consistency.
+//
+// Transactions are double-buffered. The last end_op() of a
+// transaction waits LOG_GROUP_DELAY_US for more system calls to
+// join (group commit), unless this transaction and the one before
+// each held a single system call, then closes it: the logged blocks
+// are copied into their log slots' buffers, a new transaction
+// opens, and only then are the copies written out. So begin_op() waits only for that
+// copy, never for the disk, and a whole batch of end_op()s returns
+// once the one commit is on disk. One closed transaction is written
+// at a time.
+//
+// The log is a physical re-do log containing disk blocks,
+// used as a ring of log.size slots (sb->nlog - 1). Committing a
+// transaction appends a commit block and then its blocks to the
+// ring, all in one batch of writes; that is all end_op() waits for.
+// The commit block carries the transaction's sequence number and a
+// checksum over itself and the blocks, so a torn commit is simply
+// not valid, and no header write is needed. The blocks stay pinned
+// in the buffer cache, so readers see the new contents, until the
+// checkpointer process has copied them to their home locations and
+// written the header that moves the ring's tail past them.
 //
-// The log is a physical re-do log containing disk blocks.
 // The on-disk log format:
-//   header block, containing block #s for block A, B, C, ...
-//   block A
-//   block B
-//   block C
-//   ...
-// Log appends are synchronous.
-
-// Contents of the header block, used for both the on-disk header block
-// and to keep track in memory of logged block# before commit.
+//   header block: tail slot and the sequence number of the
+//                 transaction whose commit block is there
+//   slot 0 .. slot log.size-1
+// Recovery replays transactions from tail while each commit block
+// has the next sequence number and a matching checksum.
+
+// Contents of the header block.
 struct logheader {
+  int tail;   // first slot not yet installed
+  uint seq;   // the transaction that starts there
+};
+
+// The commit block, the first slot of each transaction in the ring.
+struct logcommit {
+  uint magic;  // LOG_MAGIC
+  uint seq;
+  uint csum;   // Adler-32 of this block (with csum 0), then the n blocks
+  int n;
+  int block[LOG_MAXBLOCKS];
+};
+
+#define LOG_MAGIC 0x4c4f4721
+
+// Logged block numbers of a transaction, in memory.
+struct logtxn {
   int n;
-  int block[LOGBLOCKS];
+  int block[LOG_MAXBLOCKS];
 };
 
 struct log {
   struct spinlock lock;
   int start;
+  int size;        // ring slots
   int outstanding; // how many FS sys calls are executing.
-  int committing;  // in commit(), please wait.
+  int reserved;    // log blocks they reserved in begin_op()
+  int closing;     // copying out the open transaction, please wait.
+  int committing;  // a closed transaction is being written.
+  int leader;      // an end_op() is about to close the open transaction.
+  int nops;        // begin_op() calls in the open transaction so far
+  int lastops;     // and in the last one closed
   int dev;
-  struct logheader lh;
+  uint seq;        // the open transaction
+  uint done;       // the last transaction on disk
+  struct logtxn lh;                 // the open transaction
+  struct buf *lbuf[LOG_MAXBLOCKS];  // its pinned buffers
+
+  // the closed transaction being written, owned by its leader.
+  int inflight;                 // its size with the commit block, reserved in the ring
+  struct logtxn clh;
+  struct buf *cbuf[LOG_MAXBLOCKS];  // its pinned buffers
+  struct buf *cto[LOG_MAXBLOCKS];   // its log slot buffers: commit block, then the copies
+
+  // committed, not yet installed: ring slots tail .. tail+ncommitted-1,
+  // starting with the commit block of transaction tailseq.
+  int tail;
+  uint tailseq;
+  int ncommitted;
+  int ring[LOG_MAXBLOCKS];          // home block of each slot, -1 for a commit block
+  struct buf *ringbuf[LOG_MAXBLOCKS]; // pinned cache buffer of each slot
+  int ckpt_wanted;              // begin_op() is waiting for space
+  uint lazy;                    // sb->commit_ticks: 0, or commit the open transaction this late
+  uint opened;                  // ticks when the open transaction logged its first block
+  int crashpt;                  // LOGCRASH_* armed by logcrash(), or 0
+
+  uint64 commits;
+  uint64 commit_blocks; // blocks in those commits
+  uint64 ops;           // end_op() calls
+  uint rate_start;      // ticks when the current commit-rate window began
+  uint rate_count;      // commits in it
+  uint commits_per_sec; // over the last full window
+  uint64 checkpoints;
+  uint64 installed;   // home writes by the checkpointer
+  uint64 superseded;  // slots skipped because a later slot had the block
+  uint64 space_waits; // begin_op() sleeps for log space
+  uint64 writes;      // log_write() calls
+  uint64 absorbed;    // of those, blocks already in the open transaction
+  uint64 forces;      // log_force() calls (fsync, O_SYNC writes)
+  uint64 lat_commits[LOG_LAT_BUCKETS]; // commits of 1, 2-3, 4-7, ... blocks
+  uint64 lat_us[LOG_LAT_BUCKETS];      // their close-to-commit-on-disk time
 };
 struct log log;
 
 static void recover_from_log(void);
 static void commit();
+static void checkpointer(void);
+static void committer(void);
 
 void
 initlog(int dev, struct superblock *sb)
 {
-  if (sizeof(struct logheader) >= BSIZE)
-    panic("initlog: too big logheader");
+  if (sizeof(struct logcommit) > BSIZE)
+    panic("initlog: too big commit block");
 
   initlock(&log.lock, "log");
   log.start = sb->logstart;
+  log.size = sb->nlog - 1;
+  if (log.size > LOG_MAXBLOCKS)
+    log.size = LOG_MAXBLOCKS;
+  if (log.size < 2*MAXOPBLOCKS)
+    panic("initlog: log too small");
   log.dev = dev;
+  log.lazy = sb->commit_ticks;
   recover_from_log();
+  log.rate_start = ticks;
+  kproc_create("logckpt", checkpointer);
+  if (log.lazy)
+    kproc_create("logcommit", committer);
 }
 
-// Copy committed blocks from log to their home location
+// Write the header: recovery starts at slot tail, expecting
+// transaction seq there.
 static void
-install_trans(int recovering)
+write_head(int tail, uint seq)
 {
-  int tail;
+  struct buf *buf = bread(log.dev, log.start);
+  struct logheader *lh = (struct logheader *) (buf->data);
+  memset(buf->data, 0, BSIZE);
+  lh->tail = tail;
+  lh->seq = seq;
+  bwrite(buf);
+  brelse(buf);
+}
 
-  for (tail = 0; tail < log.lh.n; tail++) {
-    if(recovering) {
-      printf("recovering tail %d dst %d\n", tail, log.lh.block[tail]);
-    }
-    struct buf *lbuf = bread(log.dev, log.start+tail+1); // read log block
-    struct buf *dbuf = bread(log.dev, log.lh.block[tail]); // read dst
-    memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst
-    bwrite(dbuf);  // write dst to disk
-    if(recovering == 0)
-      bunpin(dbuf);
-    brelse(lbuf);
-    brelse(dbuf);
+// Read the commit block at slot into c. Returns 0 if it is
+// transaction seq's and its checksum matches what is on disk.
+static int
+read_commit(int slot, uint seq, struct logcommit *c)
+{
+  struct buf *b = bread(log.dev, log.start+slot+1);
+  memmove(c, b->data, sizeof(*c));
+  brelse(b);
+  if (c->magic != LOG_MAGIC || c->seq != seq || c->n < 1 || c->n > log.size - 1)
+    return -1;
+
+  uint want = c->csum;
+  c->csum = 0;
+  uint sum = adler32_update(1, (uchar*)c, sizeof(*c));
+  for (int i = 0; i < c->n; i++) {
+    b = bread(log.dev, log.start + (slot + 1 + i) % log.size + 1);
+    sum = adler32_update(sum, b->data, BSIZE);
+    brelse(b);
   }
+  c->csum = want;
+  return sum == want ? 0 : -1;
 }
 
-// Read the log header from disk into the in-memory log header
+// Copy committed transactions from the log to their home locations
+// at boot, before anything else uses the file system.
 static void
-read_head(void)
+recover_from_log(void)
 {
+  static struct logcommit c;  // too big for the stack
+  int i, scanned = 0;
+
   struct buf *buf = bread(log.dev, log.start);
   struct logheader *lh = (struct logheader *) (buf->data);
-  int i;
-  log.lh.n = lh->n;
-  for (i = 0; i < log.lh.n; i++) {
-    log.lh.block[i] = lh->block[i];
-  }
+  int tail = lh->tail;
+  uint seq = lh->seq;
   brelse(buf);
+  if (tail < 0 || tail >= log.size)
+    panic("recover_from_log: bad log header");
+
+  while (scanned < log.size && read_commit(tail, seq, &c) == 0 &&
+         scanned + 1 + c.n <= log.size) {
+    printf("recovering transaction %d: %d blocks\n", seq, c.n);
+    for (i = 0; i < c.n; i++) {
+      int slot = (tail + 1 + i) % log.size;
+      struct buf *lbuf = bread(log.dev, log.start+slot+1); // read log block
+      struct buf *dbuf = bread(log.dev, c.block[i]);       // read dst
+      memmove(dbuf->data, lbuf->data, BSIZE);  // copy block to dst
+      bwrite(dbuf);  // write dst to disk
+      brelse(lbuf);
+      brelse(dbuf);
+    }
+    scanned += 1 + c.n;
+    tail = (tail + 1 + c.n) % log.size;
+    seq++;
+  }
+
+  // skip a sequence number: a torn commit block left at tail
+  // carries seq, and must never pass for the next transaction.
+  seq++;
+  write_head(tail, seq); // clear the log
+  log.tail = tail;
+  log.tailseq = seq;
+  log.ncommitted = 0;
+  log.seq = seq;
+  log.done = seq - 1;
 }
 
-// Write in-memory log header to disk.
-// This is the true point at which the
-// current transaction commits.
+// Simulated power failure for the crash tests: stop this hart
+// with the disk as it is; test-xv6.py then kills qemu.
 static void
-write_head(void)
+crash_stop(int pt)
 {
-  struct buf *buf = bread(log.dev, log.start);
-  struct logheader *hb = (struct logheader *) (buf->data);
-  int i;
-  hb->n = log.lh.n;
-  for (i = 0; i < log.lh.n; i++) {
-    hb->block[i] = log.lh.block[i];
-  }
-  bwrite(buf);
-  brelse(buf);
+  printf("logcrash: stopped at point %d\n", pt);
+  intr_off();
+  for(;;)
+    ;
 }
 
-static void
-recover_from_log(void)
+// Arm a crash point (LOGCRASH_*) for the next commit or checkpoint.
+void
+log_crash(int pt)
 {
-  read_head();
-  install_trans(1); // if committed, copy from log to disk
-  log.lh.n = 0;
-  write_head(); // clear the log
+  acquire(&log.lock);
+  log.crashpt = pt;
+  release(&log.lock);
+}
+
+#define CYCLES_PER_US 10  // qemu virt's time base is 10MHz
+
+// The largest reservation a single begin_op() may ask for.
+// Half the ring, so a closed transaction of that size can be
+// written while the next one fills.
+int
+log_opmax(void)
+{
+  return log.size / 2;
 }
 
-// called at the start of each FS system call.
+// called at the start of each FS system call, which will log
+// at most nblocks distinct blocks.
 void
-begin_op(void)
+begin_op(int nblocks)
 {
+  if(nblocks < 1 || nblocks > log_opmax())
+    panic("begin_op: bad reservation");
+
   acquire(&log.lock);
   while(1){
-    if(log.committing){
+    if(log.closing){
       sleep(&log, &log.lock);
-    } else if(log.lh.n + (log.outstanding+1)*MAXOPBLOCKS > LOGBLOCKS){
-      // this op might exhaust log space; wait for commit.
+    } else if(log.ncommitted + log.inflight + 1 + log.lh.n +
+              log.reserved + nblocks > log.size){
+      // this op might exhaust log space; wait for the checkpointer.
+      log.space_waits++;
+      log.ckpt_wanted = 1;
+      wakeup(&log.ckpt_wanted);
       sleep(&log, &log.lock);
     } else {
       log.outstanding += 1;
+      log.reserved += nblocks;
+      log.nops++;
+      myproc()->logres = nblocks;
+      // a commit leader waiting for company can stop waiting.
+      if(log.leader)
+        wakeup(&log);
       release(&log.lock);
       break;
     }
   }
 }
 
+// Wait until transaction seq is on disk, committing it if no system
+// call is still in it. Caller holds log.lock.
+static void
+commit_wait(uint seq)
+{
+  while((int)(log.done - seq) < 0){
+    if(log.seq == seq && log.lh.n == 0){
+      // nothing logged so far: nothing to wait for.
+      break;
+    }
+    if(log.seq != seq || log.outstanding > 0 || log.leader){
+      // closed and being written, or someone else will close it.
+      sleep(&log, &log.lock);
+      continue;
+    }
+
+    // last one out: give other system calls a moment to join,
+    // sleeping until begin_op() admits one or the alarm goes off.
+    // A lone writer, alone in this transaction and the last, has
+    // no one to wait for.
+    log.leader = 1;
+    uint64 until = r_time() + LOG_GROUP_DELAY_US * CYCLES_PER_US;
+    if(log.nops <= 1 && log.lastops <= 1)
+      until = 0;
+    while(r_time() < until && log.outstanding == 0 && !log.ckpt_wanted){
+      alarm_at(until, &log);
+      sleep(&log, &log.lock);
+    }
+    // only one closed transaction at a time.
+    while(log.committing)
+      sleep(&log, &log.lock);
+    if(log.outstanding == 0)
+      commit();   // releases and re-acquires log.lock
+    log.leader = 0;
+  }
+}
+
 // called at the end of each FS system call.
-// commits if this was the last outstanding operation.
+// returns once the transaction holding this call's updates is on disk,
+// or at once if the log is lazy and the transaction is small.
+// the last call out of a transaction commits it.
 void
 end_op(void)
 {
-  int do_commit = 0;
-
   acquire(&log.lock);
   log.outstanding -= 1;
-  if(log.committing)
-    panic("log.committing");
-  if(log.outstanding == 0){
-    do_commit = 1;
-    log.committing = 1;
-  } else {
-    // begin_op() may be waiting for log space,
-    // and decrementing log.outstanding has decreased
-    // the amount of reserved space.
-    wakeup(&log);
-  }
+  log.reserved -= myproc()->logres;
+  myproc()->logres = 0;
+  log.ops++;
+  // begin_op() may be waiting for log space, and this call's
+  // reservation is now free; log_force() may be waiting for
+  // the last call out.
+  wakeup(&log);
+
+  if(!log.lazy || log.lh.n >= log.size/4)
+    commit_wait(log.seq);
   release(&log.lock);
+}
 
-  if(do_commit){
-    // call commit w/o holding locks, since not allowed
-    // to sleep with locks.
-    commit();
-    acquire(&log.lock);
-    log.committing = 0;
-    wakeup(&log);
-    release(&log.lock);
+// The transaction a system call between begin_op() and end_op()
+// is part of.
+uint
+log_opseq(void)
+{
+  acquire(&log.lock);
+  uint seq = log.seq;
+  release(&log.lock);
+  return seq;
+}
+
+// Make everything logged so far durable: commit the open
+// transaction now if it holds anything, and wait for it and
+// for any closed transaction still being written.
+void
+log_force(void)
+{
+  acquire(&log.lock);
+  log.forces++;
+  commit_wait(log.lh.n > 0 ? log.seq : log.seq - 1);
+  release(&log.lock);
+}
+
+// Copy the closed transaction's blocks from cache into the log slot
+// buffers after slot head, and fill in its commit block at head,
+// keeping the slot buffers locked in log.cto[]. The slot buffers
+// of a stretch up to the end of the ring are fetched together.
+static void
+copy_log(int head, uint seq)
+{
+  int i, k, n = log.clh.n;
+
+  for (i = 0; i < n + 1; i += k) {
+    int slot = (head + i) % log.size;
+    k = n + 1 - i;
+    if (k > log.size - slot)
+      k = log.size - slot;
+    k = bread_range(log.dev, log.start+slot+1, k, log.cto + i); // log blocks
+    for (int j = 0; j < k; j++) {
+      if (i + j == 0)
+        continue;  // the commit block
+      struct buf *from = bread(log.dev, log.clh.block[i+j-1]); // cache block
+      memmove(log.cto[i+j]->data, from->data, BSIZE);
+      brelse(from);
+    }
   }
+
+  struct logcommit *c = (struct logcommit *) log.cto[0]->data;
+  memset(log.cto[0]->data, 0, BSIZE);
+  c->magic = LOG_MAGIC;
+  c->seq = seq;
+  c->n = n;
+  memmove(c->block, log.clh.block, n * sizeof(c->block[0]));
+  uint sum = adler32_update(1, (uchar*)c, sizeof(*c));
+  for (i = 1; i <= n; i++)
+    sum = adler32_update(sum, log.cto[i]->data, BSIZE);
+  c->csum = sum;
 }
 
-// Copy modified blocks from cache to log.
+// Write the commit block and the copies in log.cto[] to disk in one
+// batch, a request per stretch of slots, all in flight together;
+// release them. Once they are all on disk the transaction is committed.
 static void
 write_log(void)
 {
-  int tail;
+  int n = log.clh.n + 1;
 
-  for (tail = 0; tail < log.lh.n; tail++) {
-    struct buf *to = bread(log.dev, log.start+tail+1); // log block
-    struct buf *from = bread(log.dev, log.lh.block[tail]); // cache block
-    memmove(to->data, from->data, BSIZE);
-    bwrite(to);  // write the log
-    brelse(from);
-    brelse(to);
+  if (log.crashpt == LOGCRASH_TORN) {
+    bwrite_batch(log.cto, 1 + log.clh.n/2);
+    crash_stop(LOGCRASH_TORN);
   }
+  bwrite_batch(log.cto, n);  // write the log
+  for (int i = 0; i < n; i++)
+    brelse(log.cto[i]);
 }
 
+// Close the open transaction and write it to the log.
+// Caller holds log.lock, leads the transaction, and has checked
+// that no system call is in it and no other commit is running.
+// Returns with log.lock held again.
 static void
 commit()
 {
-  if (log.lh.n > 0) {
-    write_log();     // Write modified blocks from cache to log
-    write_head();    // Write header to disk -- the real commit
-    install_trans(0); // Now install writes to home locations
-    log.lh.n = 0;
-    write_head();    // Erase the transaction from the log
+  uint seq = log.seq;
+  int head, i, n = log.lh.n;
+  uint64 t0 = r_time();
+
+  if (n == 0)
+    return;
+
+  // close: take the transaction over, copy its blocks out while
+  // begin_op() waits, then open the next transaction.
+  log.closing = 1;
+  log.committing = 1;
+  log.inflight = n + 1;
+  log.clh.n = n;
+  for (i = 0; i < n; i++) {
+    log.clh.block[i] = log.lh.block[i];
+    log.cbuf[i] = log.lbuf[i];
+  }
+  // begin_op() reserved the space, and the checkpointer
+  // only ever frees slots, so head .. head+n are free.
+  head = (log.tail + log.ncommitted) % log.size;
+  release(&log.lock);
+
+  copy_log(head, seq);
+
+  acquire(&log.lock);
+  log.lh.n = 0;
+  log.seq++;
+  log.lastops = log.nops;
+  log.nops = 0;
+  log.closing = 0;
+  wakeup(&log);
+  release(&log.lock);
+
+  write_log();       // Write the log -- the real commit
+  if (log.crashpt == LOGCRASH_COMMIT)
+    crash_stop(LOGCRASH_COMMIT);
+
+  // only now is the transaction in the ring, so the checkpointer
+  // never installs a commit that is not on disk.
+  acquire(&log.lock);
+  log.ring[head] = -1;
+  log.ringbuf[head] = 0;
+  for (i = 0; i < n; i++) {
+    int slot = (head + 1 + i) % log.size;
+    log.ring[slot] = log.clh.block[i];
+    log.ringbuf[slot] = log.cbuf[i];  // pin passes to the ring
+  }
+  log.ncommitted += n + 1;
+  log.inflight = 0;
+  log.commits++;
+  log.commit_blocks += n;
+  if(ticks - log.rate_start >= 10){
+    log.commits_per_sec = log.rate_count * 10 / (ticks - log.rate_start);
+    log.rate_start = ticks;
+    log.rate_count = 0;
+  }
+  log.rate_count++;
+  if(log.crashpt == LOGCRASH_INSTALL)
+    log.ckpt_wanted = 1;
+  if(log.ncommitted >= log.size/2 || log.ckpt_wanted)
+    wakeup(&log.ckpt_wanted);
+
+  int b = 0;
+  while (b < LOG_LAT_BUCKETS-1 && (2 << b) <= n)
+    b++;
+  log.lat_commits[b]++;
+  log.lat_us[b] += (r_time() - t0) / CYCLES_PER_US;
+  log.committing = 0;
+  log.done = seq;
+  fs_committed(seq);  // blocks it freed may now be reused
+  wakeup(&log);
+}
+
+// Write the nb blocks gathered in cbp[] home as one batch. The ring
+// slots keep their pins until checkpoint() has written the header.
+static void
+install(struct buf **cbp, int nb)
+{
+  if (nb == 0)
+    return;
+  bwriteback(cbp, nb);
+  log.installed += nb;
+}
+
+// Install the committed transactions to their home locations and
+// free their slots. The log copy is what gets written, not the cached
+// buffer, which may already hold a later, uncommitted change.
+// Copies are gathered into cb[] and written CKPT_BUFS at a time,
+// slots with adjacent home blocks sharing a request and all the
+// requests of a batch in flight together.
+static void
+checkpoint(struct buf *cb)
+{
+  struct buf *lb[MAXRANGE], *cbp[CKPT_BUFS];
+  int tail, n, i, j, k, nb = 0, ntxn = 0;
+  uint seq;
+
+  // slots in the ring are on disk.
+  acquire(&log.lock);
+  tail = log.tail;
+  seq = log.tailseq;
+  n = log.ncommitted;
+  release(&log.lock);
+
+  for (i = 0; i < n; i += k) {
+    if (log.ring[(tail + i) % log.size] < 0) {
+      // a commit block: nothing to install.
+      ntxn++;
+      k = 1;
+      continue;
+    }
+
+    // length of the run starting at i: slots not superseded later,
+    // not wrapping, with consecutive home blocks.
+    for (k = 0; i + k < n && k < MAXRANGE; k++) {
+      int slot = (tail + i + k) % log.size;
+      int home = log.ring[slot];
+      if (k > 0 && (slot == 0 || home != log.ring[(slot - 1 + log.size) % log.size] + 1))
+        break;
+      for (j = i + k + 1; j < n; j++)
+        if (log.ring[(tail + j) % log.size] == home)
+          break;
+      if (j < n)
+        break;
+    }
+
+    if (k == 0) {
+      // a later slot rewrites this block; only the last counts.
+      log.superseded++;
+      k = 1;
+      continue;
+    }
+
+    if (nb + k > CKPT_BUFS) {
+      install(cbp, nb);
+      nb = 0;
+    }
+    int slot0 = (tail + i) % log.size;
+    k = bread_range(log.dev, log.start+slot0+1, k, lb);
+    for (j = 0; j < k; j++) {
+      memmove(cb[nb].data, lb[j]->data, BSIZE);
+      brelse(lb[j]);
+      cb[nb].dev = log.dev;
+      cb[nb].blockno = log.ring[slot0 + j];
+      cbp[nb] = &cb[nb];
+      nb++;
+    }
+  }
+  install(cbp, nb);
+  if (log.crashpt == LOGCRASH_INSTALL)
+    crash_stop(LOGCRASH_INSTALL);
+
+  // erase the installed transactions from the log before
+  // their slots can be reused.
+  tail = (tail + n) % log.size;
+  seq += ntxn;
+  write_head(tail, seq);
+
+  // only now may the buffers be evicted: until the header is on
+  // disk, recovery would replay these slots, and log_holds() must
+  // still see their logseq.
+  for (i = 0; i < n; i++) {
+    int slot = (log.tail + i) % log.size;
+    if (log.ringbuf[slot]) {
+      bunpin(log.ringbuf[slot]);
+      log.ringbuf[slot] = 0;
+    }
+  }
+
+  acquire(&log.lock);
+  log.tail = tail;
+  log.tailseq = seq;
+  log.ncommitted -= n;
+  log.checkpoints++;
+  wakeup(&log);    // begin_op() may be waiting for space
+  release(&log.lock);
+}
+
+// The lazy-mode committer process. Once a tick, commits the open
+// transaction if it is log.lazy ticks old, or if begin_op() is
+// short of space.
+static void
+committer(void)
+{
+  for(;;){
+    acquire(&tickslock);
+    sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    acquire(&log.lock);
+    if(log.lh.n > 0 && (ticks - log.opened >= log.lazy || log.ckpt_wanted))
+      commit_wait(log.seq);
+    release(&log.lock);
+  }
+}
+
+// The checkpointer process. Installs committed transactions once
+// half the ring is in use, or sooner if begin_op() runs out of space.
+static void
+checkpointer(void)
+{
+  // private buffers for home writes, never in the cache.
+  static struct buf cb[CKPT_BUFS];
+  for(int i = 0; i < CKPT_BUFS; i += PGSIZE/BSIZE){
+    char *pg = kalloc();
+    if(pg == 0)
+      panic("checkpointer: kalloc");
+    for(int j = 0; j < PGSIZE/BSIZE && i + j < CKPT_BUFS; j++)
+      cb[i+j].data = (uchar*)pg + j*BSIZE;
+  }
+
+  for(;;){
+    acquire(&log.lock);
+    while(log.ncommitted == 0 ||
+          (log.ncommitted < log.size/2 && !log.ckpt_wanted))
+      sleep(&log.ckpt_wanted, &log.lock);
+    log.ckpt_wanted = 0;
+    release(&log.lock);
+
+    checkpoint(cb);
   }
 }
 
 // Caller has modified b->data and is done with the buffer.
 // Record the block number and pin in the cache by increasing refcnt.
-// commit()/write_log() will do the disk write.
+// commit()/write_log() will do the disk write. A buffer already in
+// the open transaction carries its sequence number in b->logseq,
+// so absorbing a rewrite costs no search.
 //
 // log_write() replaces bwrite(); a typical use is:
 //   bp = bread(...)
@@ -218,20 +688,64 @@ log_write(struct buf *b)
   int i;
 
   acquire(&log.lock);
-  if (log.lh.n >= LOGBLOCKS)
+  if (log.lh.n >= log.size - 1)
     panic("too big a transaction");
   if (log.outstanding < 1)
     panic("log_write outside of trans");
 
-  for (i = 0; i < log.lh.n; i++) {
-    if (log.lh.block[i] == b->blockno)   // log absorption
-      break;
-  }
-  log.lh.block[i] = b->blockno;
-  if (i == log.lh.n) {  // Add new block to log?
+  log.writes++;
+  if (b->logseq == log.seq) {   // log absorption
+    log.absorbed++;
+  } else {  // Add new block to log
+    if (log.lh.n == 0)
+      log.opened = ticks;
+    i = log.lh.n++;
+    log.lh.block[i] = b->blockno;
+    log.lbuf[i] = b;
+    b->logseq = log.seq;
     bpin(b);
-    log.lh.n++;
   }
   release(&log.lock);
 }
 
+// Is b's block in the open or the closed transaction, or committed
+// but still in the on-disk log? That is, was it last logged no
+// earlier than the oldest transaction still in the ring? A logged
+// buffer stays pinned until the header drops its slot, so logseq
+// is intact for as long as the answer matters.
+int
+log_holds(struct buf *b)
+{
+  int held;
+
+  acquire(&log.lock);
+  held = b->logseq != 0 && (int)(b->logseq - log.tailseq) >= 0;
+  release(&log.lock);
+  return held;
+}
+
+// Log telemetry for statfs.
+void
+log_stats(struct hai_statfs *st)
+{
+  acquire(&log.lock);
+  st->log_pending = log.ncommitted;
+  st->log_commits = log.commits;
+  st->log_commit_blocks = log.commit_blocks;
+  st->log_ops = log.ops;
+  st->log_commits_per_sec = log.commits_per_sec;
+  st->log_blocks_per_commit = log.commits ? log.commit_blocks / log.commits : 0;
+  st->log_checkpoints = log.checkpoints;
+  st->log_installed = log.installed;
+  st->log_superseded = log.superseded;
+  st->log_space_waits = log.space_waits;
+  st->log_writes = log.writes;
+  st->log_absorbed = log.absorbed;
+  st->log_forces = log.forces;
+  st->log_lazy_ticks = log.lazy;
+  for(int i = 0; i < LOG_LAT_BUCKETS; i++){
+    st->log_lat_commits[i] = log.lat_commits[i];
+    st->log_lat_us[i] = log.lat_us[i];
+  }
+  release(&log.lock);
+}
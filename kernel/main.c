@@ -87,6 +87,7 @@ primary_init_sequence(void)
   // 文件系统相关子系统
   klog(LOG_INFO, "fs: buffer cache");
   binit();         // buffer cache
+  csum_init();     // checksum tables
   klog(LOG_INFO, "fs: inode table");
   iinit();         // inode table
   klog(LOG_INFO, "fs: file table");
@@ -6,9 +6,24 @@
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
-#define MAXOPBLOCKS  10  // max # of blocks any FS op writes
-#define LOGBLOCKS    (MAXOPBLOCKS*3)  // max data blocks in on-disk log
-#define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
+#define MAXOPBLOCKS  10  // log blocks reserved by a typical FS op (begin_op)
+#ifndef LOGBLOCKS
+#define LOGBLOCKS    126   // data blocks in the on-disk log mkfs lays out
+#endif
+#define LOG_MAXBLOCKS 250  // most log slots used; the header must fit in 1 KiB
+#define LOG_GROUP_DELAY_US 200 // last end_op() waits this long for others to join its commit
+#define MAXRANGE     32    // max blocks in one multi-block disk request
+#define CKPT_BUFS    (MAXRANGE*2) // home blocks the checkpointer writes per batch
+#define FMAP_PAGES   16    // in-memory free map pages: 16*32768 blocks at most
+#define BALLOC_SCAN_RUNS 32 // free runs balloc_extent() looks at for a long one
+#define BCACHE_MIN_BUFS  (LOGBLOCKS*2+MAXRANGE*2) // buffer cache never shrinks below this
+#define BCACHE_MAX_PCT   10    // buffer cache may grow to this % of RAM
+#define NBUCKET      2039  // buffer cache hash buckets (prime)
+#ifndef BCACHE_2Q
+#define BCACHE_2Q    1     // scan-resistant buffer replacement (0: plain CLOCK)
+#endif
+#define READAHEAD_MIN    2     // first readahead window, in blocks
+#define READAHEAD_MAX    16    // readahead window limit, in blocks
 #define FSSIZE       8000  // size of file system in blocks (1KB blocks)
 #define MAXPATH      128   // maximum file path name
 #define USERSTACK    1     // user stack pages
@@ -25,6 +40,31 @@
 #define SLICE_P2_TICKS 4
 #define SLICE_P3_TICKS 2
 
+// Fair-share class (HAI_SCHED_FAIR): fixed slice, no demotion; the
+// process with the least weighted CPU time (vruntime) runs next.
+#define SLICE_FAIR_TICKS 4
+
+// Real-time class (HAI_SCHED_RT): FIFO within each priority level,
+// above every MLFQ and FAIR process, never demoted. To keep a runaway
+// RT process from starving the system, RT processes may use at most
+// SCHED_RT_RUNTIME of every SCHED_RT_PERIOD ticks on a hart.
+#define SCHED_RT_PERIOD  10
+#define SCHED_RT_RUNTIME 9
+
+// Class that init starts in, and so every process that never calls
+// sched_setclass(): 0 = MLFQ, 1 = fair-share. `make SCHED=fair` sets 1.
+#ifndef SCHED_DEFAULT_CLASS
+#define SCHED_DEFAULT_CLASS 0
+#endif
+
+// Buckets of the run-delay histograms; hai_sysinfo.h's
+// HAI_LAT_BUCKETS must match.
+#define SCHED_LAT_BUCKETS 8
+
+// Cache affinity: when picking among equal-priority processes, a hart
+// treats one that last ran on it as having waited this many ticks longer.
+#define SCHED_AFFINITY_BONUS 2
+
 // Memory watermarks（pages）用于低内存提醒
 #define MEM_LOW_WATERMARK_PAGES      64
 #define MEM_CRIT_WATERMARK_PAGES     32
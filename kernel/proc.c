@@ -5,9 +5,14 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
+#include "hai_sysinfo.h"
 
 struct cpu cpus[NCPU];
 
+// the user-visible arrays must hold what the kernel keeps.
+_Static_assert(HAI_MAX_HARTS >= NCPU, "hai_schedinfo.harts is smaller than NCPU");
+_Static_assert(HAI_LAT_BUCKETS == SCHED_LAT_BUCKETS, "HAI_LAT_BUCKETS != SCHED_LAT_BUCKETS");
+
 struct proc proc[NPROC];
 
 struct proc *initproc;
@@ -16,6 +21,7 @@ int nextpid = 1;
 struct spinlock pid_lock;
 
 extern void forkret(void);
+static void kprocret(void);
 static void freeproc(struct proc *p);
 
 extern char trampoline[]; // trampoline.S
@@ -26,6 +32,40 @@ extern char trampoline[]; // trampoline.S
 // must be acquired before any p->lock.
 struct spinlock wait_lock;
 
+// Per-hart scheduler statistics. Each hart only updates its own
+// entry, so no lock is needed; sched_stats() sums them.
+static struct {
+  uint64 wakelat[SCHED_LAT_BUCKETS]; // wakeup-to-run latency histogram
+  uint64 ipi_sent;
+  uint64 ipi_recv;
+  uint64 migrations;
+  uint64 nswitch;       // processes dispatched
+  uint64 idle_cycles;   // time in wfi with nothing to run
+  uint64 start;         // r_time() when the hart entered scheduler()
+  uint64 rt_period;     // ticks value when the current RT period began
+  int rt_used;          // ticks RT processes ran in this period
+  uint64 rt_throttled;  // periods in which RT hit SCHED_RT_RUNTIME
+  uint64 deadline_misses;
+} schedstat[NCPU];
+
+#define AFFINITY_ALL ((1L << NCPU) - 1)
+
+// qemu virt's time base (r_time()) runs at 10MHz.
+#define CYCLES_PER_US 10
+
+// Fair-share weights by priority; PRI_DEFAULT gets FAIR_WEIGHT_UNIT,
+// and each level up doubles the CPU share.
+#define FAIR_WEIGHT_UNIT 1024
+static const int fair_weight[PRI_LEVELS] = { 512, 1024, 2048, 4096 };
+
+// A waking FAIR process may start up to half a slice behind
+// min_vruntime, so sleepers get a little credit but can't bank it.
+#define FAIR_WAKEUP_CREDIT (SLICE_FAIR_TICKS * 1000000L / 2)
+
+// Lower bound on the vruntime of runnable FAIR processes; only moves
+// forward. Processes joining the class start from here.
+static uint64 min_vruntime;
+
 static inline int
 slice_for_priority(int prio)
 {
@@ -42,6 +82,111 @@ slice_for_priority(int prio)
   return slices[prio];
 }
 
+// Rank of p for preemption, kept in cpu->run_prio: MLFQ ranks by
+// priority, every FAIR process ranks just above MLFQ (so MLFQ wakeups
+// don't preempt it), and RT ranks above both.
+static inline int
+run_rank(struct proc *p)
+{
+  if(p->sched_class == HAI_SCHED_RT)
+    return PRI_MAX + 2 + p->priority;
+  if(p->sched_class == HAI_SCHED_FAIR)
+    return PRI_MAX + 1;
+  return p->priority;
+}
+
+// Has this hart's RT budget for the current period run out?
+// Starts a new period when the old one is over.
+// Only called on hart id itself, with interrupts off.
+static int
+rt_throttled(int id)
+{
+  if(ticks - schedstat[id].rt_period >= SCHED_RT_PERIOD){
+    schedstat[id].rt_period = ticks;
+    schedstat[id].rt_used = 0;
+  }
+  return schedstat[id].rt_used >= SCHED_RT_RUNTIME;
+}
+
+// Slice for p's next turn on a CPU.
+static inline int
+proc_slice(struct proc *p)
+{
+  if(p->sched_class == HAI_SCHED_FAIR)
+    return SLICE_FAIR_TICKS;
+  return slice_for_priority(p->priority);
+}
+
+int
+fair_weight_of(int prio)
+{
+  if(prio < PRI_MIN)
+    prio = PRI_MIN;
+  if(prio > PRI_MAX)
+    prio = PRI_MAX;
+  return fair_weight[prio];
+}
+
+// Charge p for the cycles since it was dispatched.
+// Caller must hold p->lock.
+static void
+charge_runtime(struct proc *p)
+{
+  uint64 delta = r_time() - p->run_start;
+
+  p->cputime += delta;
+  if(p->sched_class == HAI_SCHED_FAIR)
+    p->vruntime += delta * FAIR_WEIGHT_UNIT / fair_weight_of(p->priority);
+}
+
+// Move min_vruntime forward to v. Harts race here, so use CAS.
+static void
+advance_min_vruntime(uint64 v)
+{
+  uint64 old;
+
+  while((old = min_vruntime) < v){
+    if(__sync_bool_compare_and_swap(&min_vruntime, old, v))
+      break;
+  }
+}
+
+// Put a FAIR process that is (re)joining the run queue near the
+// front, but not so far back that it would monopolize the CPU.
+// Caller must hold p->lock.
+static void
+fair_place(struct proc *p, uint64 credit)
+{
+  uint64 floor = min_vruntime;
+
+  floor = floor > credit ? floor - credit : 0;
+  if(p->vruntime < floor)
+    p->vruntime = floor;
+}
+
+// Put p on the run queue, stamping when it started to wait.
+// Caller must hold p->lock.
+static void
+make_runnable(struct proc *p)
+{
+  p->state = RUNNABLE;
+  p->sched_stamp = ticks;
+  p->queued_at = r_time();
+}
+
+// Histogram bucket for a wakeup-to-run latency of cycles.
+static int
+lat_bucket(uint64 cycles)
+{
+  int i = 0;
+  uint64 bound = HAI_LAT_BASE_CYCLES;
+  while(i < SCHED_LAT_BUCKETS - 1 && cycles >= bound){
+    bound <<= 2;
+    i++;
+  }
+  return i;
+}
+
 // Allocate a page for each process's kernel stack.
 // Map it high in memory, followed by an invalid
 // guard page.
@@ -141,10 +286,26 @@ found:
   p->pid = allocpid();
   p->state = USED;
   p->priority = PRI_DEFAULT;
-  p->budget = slice_for_priority(p->priority);
+  p->sched_class = SCHED_DEFAULT_CLASS;
+  p->vruntime = min_vruntime;
+  p->budget = proc_slice(p);
   p->rtime = 0;
+  p->cputime = 0;
+  p->run_start = 0;
+  p->queued_at = 0;
+  memset(p->rundelay, 0, sizeof(p->rundelay));
+  p->rundelay_sum = 0;
+  p->rundelay_max = 0;
+  p->deadline = 0;
+  p->deadline_misses = 0;
   p->sched_cnt = 0;
   p->sched_stamp = ticks;
+  p->wake_stamp = 0;
+  p->nvcsw = 0;
+  p->nivcsw = 0;
+  p->affinity = AFFINITY_ALL;
+  p->last_cpu = -1;
+  p->migrations = 0;
   p->page_faults = 0;
 
   // Allocate a trapframe page.
@@ -191,10 +352,26 @@ freeproc(struct proc *p)
   p->killed = 0;
   p->xstate = 0;
   p->priority = PRI_DEFAULT;
-  p->budget = slice_for_priority(p->priority);
+  p->sched_class = SCHED_DEFAULT_CLASS;
+  p->vruntime = 0;
+  p->budget = proc_slice(p);
   p->rtime = 0;
+  p->cputime = 0;
+  p->run_start = 0;
+  p->queued_at = 0;
+  memset(p->rundelay, 0, sizeof(p->rundelay));
+  p->rundelay_sum = 0;
+  p->rundelay_max = 0;
+  p->deadline = 0;
+  p->deadline_misses = 0;
   p->sched_cnt = 0;
   p->sched_stamp = 0;
+  p->wake_stamp = 0;
+  p->nvcsw = 0;
+  p->nivcsw = 0;
+  p->affinity = AFFINITY_ALL;
+  p->last_cpu = -1;
+  p->migrations = 0;
   p->page_faults = 0;
   p->state = UNUSED;
 }
@@ -254,34 +431,103 @@ userinit(void)
   
   p->cwd = namei("/");
 
-  p->state = RUNNABLE;
-  p->sched_stamp = ticks;
-  p->budget = slice_for_priority(p->priority);
+  make_runnable(p);
+  p->budget = proc_slice(p);
 
   release(&p->lock);
 }
 
-// Account a timer tick to the current RUNNING process and apply simple aging.
-// Called from timer interrupt context.
+// Start a kernel process running fn(), which must not return.
+// It is scheduled like any process but never enters user space.
 void
+kproc_create(char *name, void (*fn)(void))
+{
+  struct proc *p;
+
+  if((p = allocproc()) == 0)
+    panic("kproc_create");
+  safestrcpy(p->name, name, sizeof(p->name));
+  p->kfn = fn;
+  p->context.ra = (uint64)kprocret;
+  make_runnable(p);
+  p->budget = proc_slice(p);
+  release(&p->lock);
+}
+
+// Is some RUNNABLE process more important than cur? That is an RT
+// process of higher rank (unless this hart's RT budget is spent), or
+// an MLFQ process of higher priority when cur is MLFQ too. FAIR
+// processes don't count: between FAIR and MLFQ the longer-waiting
+// one goes first, whatever its priority.
+// Lockless hint for proc_tick(); scheduler() rechecks under p->lock.
+static int
+higher_prio_waiting(struct proc *cur, int id)
+{
+  struct proc *p;
+  int rank = run_rank(cur);
+  int rt_ok = !rt_throttled(id);
+
+  for(p = proc; p < &proc[NPROC]; p++){
+    if(p->state != RUNNABLE || p->sched_class == HAI_SCHED_FAIR)
+      continue;
+    if(p->sched_class == HAI_SCHED_RT && rt_ok && run_rank(p) > rank)
+      return 1;
+    if(p->sched_class == HAI_SCHED_MLFQ && cur->sched_class == HAI_SCHED_MLFQ &&
+       p->priority > cur->priority)
+      return 1;
+  }
+  return 0;
+}
+
+// Account a timer tick to the current RUNNING process and apply simple aging.
+// Called from timer interrupt context. Returns 1 if the process should
+// be preempted: its slice is used up, or a higher-priority process waits.
+// FAIR processes are only preempted when their slice runs out and are
+// never demoted; their share comes from vruntime in scheduler().
+// RT processes have no slice: they run until they block, a higher RT
+// process arrives, or the hart's RT budget for the period is spent.
+int
 proc_tick(void)
 {
   struct proc *p = myproc();
+  int preempt = 0;
+  int id = cpuid();
+
   if(p == 0)
-    return;
+    return 0;
 
   acquire(&p->lock);
   if(p->state == RUNNING){
-    // 按 tick 计费并做简单老化：时间片耗尽则降低优先级。
+    // 按 tick 计费并做简单老化：时间片耗尽则降低优先级并让出 CPU。
     p->rtime++;
     p->budget--;
-    if(p->budget <= 0){
+    if(p->sched_class == HAI_SCHED_RT){
+      // 实时类不降级；超出本周期 RT 配额则节流，让出给普通进程。
+      if(rt_throttled(id)){
+        preempt = 1;
+      } else if(++schedstat[id].rt_used >= SCHED_RT_RUNTIME){
+        schedstat[id].rt_throttled++;
+        preempt = 1;
+      } else if(higher_prio_waiting(p, id)){
+        preempt = 1;
+      }
+    } else if(p->sched_class == HAI_SCHED_FAIR){
+      if(p->budget <= 0){
+        p->budget = SLICE_FAIR_TICKS;
+        preempt = 1;
+      }
+    } else if(p->budget <= 0){
       if(p->priority > PRI_MIN)
         p->priority -= 1; // CPU hogs 掉级
       p->budget = slice_for_priority(p->priority);
+      mycpu()->run_prio = run_rank(p);
+      preempt = 1;
     }
+    if(!preempt && p->sched_class != HAI_SCHED_RT && higher_prio_waiting(p, id))
+      preempt = 1;
   }
   release(&p->lock);
+  return preempt;
 }
 
 // Grow or shrink user memory by n bytes.
@@ -343,6 +589,16 @@ kfork(void)
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
+  // children stay on the harts the parent was pinned to,
+  // and in its scheduling class with its deadline.
+  np->affinity = p->affinity;
+  np->sched_class = p->sched_class;
+  np->deadline = p->deadline;
+  if(np->sched_class == HAI_SCHED_FAIR){
+    np->vruntime = p->vruntime;
+    fair_place(np, 0);
+  }
+
   pid = np->pid;
 
   release(&np->lock);
@@ -352,9 +608,8 @@ kfork(void)
   release(&wait_lock);
 
   acquire(&np->lock);
-  np->state = RUNNABLE;
-  np->sched_stamp = ticks;
-  np->budget = slice_for_priority(np->priority);
+  make_runnable(np);
+  np->budget = proc_slice(np);
   release(&np->lock);
 
   return pid;
@@ -395,7 +650,7 @@ kexit(int status)
     }
   }
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
   iput(p->cwd);
   end_op();
   p->cwd = 0;
@@ -476,13 +731,20 @@ kwait(uint64 addr)
 //  - swtch to start running that process.
 //  - eventually that process transfers control
 //    via swtch back to the scheduler.
+// RT processes go first, by priority and then in FIFO order, unless
+// this hart has used up its RT budget for the period. Otherwise MLFQ
+// processes are ranked by priority, FAIR ones by vruntime; when both
+// classes have a candidate, the one waiting longer wins.
 void
 scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  int id = cpuid();
 
   c->proc = 0;
+  c->online = 1;
+  schedstat[id].start = r_time();
   for(;;){
     // The most recent process to run may have had interrupts
     // turned off; enable them to avoid a deadlock if all
@@ -492,16 +754,48 @@ scheduler(void)
     intr_on();
     intr_off();
 
-    struct proc *best = 0;
+    // From here until a process is chosen, wakeup() may IPI
+    // this hart; a pending IPI also makes the wfi below return.
+    c->idle = 1;
+
+    struct proc *best = 0, *fbest = 0, *rtbest = 0;
     int best_prio = -1;
-    uint64 best_wait = 0;
+    uint64 best_wait = 0, fbest_wait = 0;
     uint64 now = ticks;
+    int rt_ok = !rt_throttled(id);
 
     for(p = proc; p < &proc[NPROC]; p++) {
       acquire(&p->lock);
-      if(p->state == RUNNABLE) {
+      if(p->state == RUNNABLE && (p->affinity & (1L << id))) {
         int pr = p->priority;
         uint64 wait = (p->sched_stamp <= now) ? (now - p->sched_stamp) : 0;
+        // 上次在本 hart 运行的进程缓存较热，视为多等了几个 tick。
+        if(p->last_cpu == id)
+          wait += SCHED_AFFINITY_BONUS;
+        if(p->sched_class == HAI_SCHED_RT){
+          // 实时类：优先级高者优先，同级先到先服务。
+          if(rt_ok && (rtbest == 0 || pr > rtbest->priority ||
+                       (pr == rtbest->priority && p->queued_at < rtbest->queued_at))){
+            if(rtbest)
+              release(&rtbest->lock);
+            rtbest = p;
+            continue;
+          }
+          release(&p->lock);
+          continue;
+        }
+        if(p->sched_class == HAI_SCHED_FAIR){
+          // 公平类：vruntime 最小者优先。
+          if(fbest == 0 || p->vruntime < fbest->vruntime){
+            if(fbest)
+              release(&fbest->lock);
+            fbest = p;
+            fbest_wait = wait;
+            continue;
+          }
+          release(&p->lock);
+          continue;
+        }
         // 优先级优先，同级选择等待最久者，避免饥饿。
         if(pr > best_prio || (pr == best_prio && (best == 0 || wait > best_wait))){
           if(best)
@@ -515,20 +809,65 @@ scheduler(void)
       release(&p->lock);
     }
 
+    if(rtbest){
+      if(best)
+        release(&best->lock);
+      if(fbest)
+        release(&fbest->lock);
+      best = rtbest;
+    } else if(fbest){
+      if(best == 0 || fbest_wait > best_wait){
+        if(best)
+          release(&best->lock);
+        best = fbest;
+      } else {
+        release(&fbest->lock);
+      }
+      if(best == fbest)
+        advance_min_vruntime(fbest->vruntime);
+    }
+
     if(best){
       // switch to chosen process
       best->state = RUNNING;
-      best->budget = slice_for_priority(best->priority);
+      if(best->budget <= 0)
+        best->budget = proc_slice(best);
       best->sched_cnt++;
       best->sched_stamp = now;
+      uint64 t = r_time();
+      uint64 delay = t - best->queued_at;
+      best->rundelay[lat_bucket(delay)]++;
+      best->rundelay_sum += delay;
+      if(delay > best->rundelay_max)
+        best->rundelay_max = delay;
+      if(best->deadline && delay > best->deadline){
+        best->deadline_misses++;
+        schedstat[id].deadline_misses++;
+      }
+      schedstat[id].nswitch++;
+      if(best->wake_stamp){
+        schedstat[id].wakelat[lat_bucket(t - best->wake_stamp)]++;
+        best->wake_stamp = 0;
+      }
+      if(best->last_cpu >= 0 && best->last_cpu != id){
+        best->migrations++;
+        schedstat[id].migrations++;
+      }
+      best->last_cpu = id;
+      c->idle = 0;
+      c->run_prio = run_rank(best);
       c->proc = best;
+      best->run_start = r_time();
       swtch(&c->context, &best->context);
       // process will return here when it yields/sleeps/exits
+      charge_runtime(best);
       c->proc = 0;
       release(&best->lock);
     } else {
       // nothing to run; stop until an interrupt
+      uint64 t0 = r_time();
       asm volatile("wfi");
+      schedstat[id].idle_cycles += r_time() - t0;
     }
   }
 }
@@ -561,22 +900,32 @@ sched(void)
 }
 
 // Give up the CPU for one scheduling round.
+// Called on preemption: the slice ran out (proc_tick() has already
+// refilled it) or a higher-priority process is waiting, in which
+// case the rest of the slice is kept for when this one runs again.
 void
 yield(void)
 {
   struct proc *p = myproc();
   acquire(&p->lock);
-  int slice = slice_for_priority(p->priority);
-  // 自愿让出 CPU 且未用完时间片时奖励升优先级，偏向交互型负载。
-  if(p->budget > slice / 2 && p->priority < PRI_MAX)
-    p->priority++;
-  p->budget = slice_for_priority(p->priority);
-  p->sched_stamp = ticks;
-  p->state = RUNNABLE;
+  p->nivcsw++;
+  make_runnable(p);
   sched();
   release(&p->lock);
 }
 
+// A kernel process's first scheduling switches here.
+static void
+kprocret(void)
+{
+  struct proc *p = myproc();
+
+  // Still holding p->lock from scheduler.
+  release(&p->lock);
+  p->kfn();
+  panic("kproc returned");
+}
+
 // A fork child's very first scheduling by scheduler()
 // will swtch to forkret.
 void
@@ -634,6 +983,7 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  p->nvcsw++;
 
   sched();
 
@@ -645,6 +995,94 @@ sleep(void *chan, struct spinlock *lk)
   acquire(lk);
 }
 
+// Send a reschedule IPI to hart id. The local hart just raises
+// its own sip.SSIP; remote harts get a CLINT machine software
+// interrupt, which mswivec in kernelvec.S forwards as SSIP.
+// Interrupts must be disabled.
+static void
+send_ipi(int id)
+{
+  schedstat[cpuid()].ipi_sent++;
+  if(id == cpuid())
+    w_sip(r_sip() | SIP_SSIP);
+  else
+    *(volatile uint32 *)CLINT_MSIP(id) = 1;
+}
+
+// Process p just became RUNNABLE. Rather than leave it until
+// some hart's next timer tick, interrupt one of its allowed harts
+// that should run it now: the hart it last ran on if that is idle,
+// another idle one, or else the one running the lowest-priority
+// process below p's (any non-RT process, for an RT one). A FAIR
+// process only takes an idle hart.
+// Reads other harts' cpu fields without locks; a stale value
+// costs at most a spurious or missed IPI.
+// Caller must hold p->lock.
+static void
+wakeup_preempt(struct proc *p)
+{
+  struct cpu *c, *target = 0;
+  int lowest = p->sched_class == HAI_SCHED_FAIR ? -1 : run_rank(p);
+
+  push_off();
+  if(p->last_cpu >= 0 && (p->affinity & (1L << p->last_cpu)) &&
+     cpus[p->last_cpu].idle)
+    target = &cpus[p->last_cpu];
+  for(c = cpus; target == 0 && c < &cpus[NCPU]; c++){
+    if((p->affinity & (1L << (c - cpus))) == 0)
+      continue;
+    if(c->idle){
+      target = c;
+      break;
+    }
+    if(c->proc && c->run_prio < lowest){
+      target = c;
+      lowest = c->run_prio;
+    }
+  }
+  if(target){
+    // let the next wakeup pick a different idle hart.
+    target->idle = 0;
+    send_ipi(target - cpus);
+  }
+  pop_off();
+}
+
+// Called from devintr() for a supervisor software interrupt.
+void
+ipi_intr(void)
+{
+  w_sip(r_sip() & ~SIP_SSIP);
+  schedstat[cpuid()].ipi_recv++;
+}
+
+// Sum the per-hart scheduler statistics for schedinfo(),
+// and report each hart's own counters.
+void
+sched_stats(struct hai_schedinfo *info)
+{
+  uint64 now = r_time();
+
+  for(int i = 0; i < NCPU; i++){
+    if(cpus[i].online){
+      struct hai_hartstat *h = &info->harts[i];
+      h->online = 1;
+      h->nswitch = schedstat[i].nswitch;
+      h->idle_cycles = schedstat[i].idle_cycles;
+      h->total_cycles = now - schedstat[i].start;
+      h->rt_throttled = schedstat[i].rt_throttled;
+    }
+    info->rt_throttled += schedstat[i].rt_throttled;
+    info->deadline_misses += schedstat[i].deadline_misses;
+    for(int b = 0; b < SCHED_LAT_BUCKETS; b++)
+      info->wakelat[b] += schedstat[i].wakelat[b];
+    info->ipi_sent += schedstat[i].ipi_sent;
+    info->ipi_recv += schedstat[i].ipi_recv;
+    info->migrations += schedstat[i].migrations;
+  }
+  info->min_vruntime = min_vruntime;
+}
+
 // Wake up all processes sleeping on channel chan.
 // Caller should hold the condition lock.
 void
@@ -656,11 +1094,16 @@ wakeup(void *chan)
     if(p != myproc()){
       acquire(&p->lock);
       if(p->state == SLEEPING && p->chan == chan) {
-        if(p->priority < PRI_MAX)
+        if(p->sched_class == HAI_SCHED_FAIR){
+          // 公平类不提升优先级，只把 vruntime 拉到 min_vruntime 附近。
+          fair_place(p, FAIR_WAKEUP_CREDIT);
+        } else if(p->sched_class == HAI_SCHED_MLFQ && p->priority < PRI_MAX){
           p->priority++; // 交互型或 I/O 负载被优先调度
-        p->budget = slice_for_priority(p->priority);
-        p->sched_stamp = ticks;
-        p->state = RUNNABLE;
+        }
+        p->budget = proc_slice(p);
+        make_runnable(p);
+        p->wake_stamp = p->queued_at;
+        wakeup_preempt(p);
       }
       release(&p->lock);
     }
@@ -681,7 +1124,7 @@ kkill(int pid)
       p->killed = 1;
       if(p->state == SLEEPING){
         // Wake process from sleep().
-        p->state = RUNNABLE;
+        make_runnable(p);
       }
       release(&p->lock);
       return 0;
@@ -702,7 +1145,7 @@ setpriority(int pid, int prio)
     acquire(&p->lock);
     if(p->pid == pid){
       p->priority = prio;
-      p->budget = slice_for_priority(prio);
+      p->budget = proc_slice(p);
       if(p->state == RUNNABLE)
         p->sched_stamp = ticks;
       release(&p->lock);
@@ -713,6 +1156,141 @@ setpriority(int pid, int prio)
   return -1;
 }
 
+// Restrict process pid (0 for the caller) to the harts in mask.
+// Returns 0, or -1 if there is no such process or mask names no
+// hart that is running the scheduler.
+int
+setaffinity(int pid, uint64 mask)
+{
+  struct proc *p;
+  uint64 online = 0;
+
+  for(int i = 0; i < NCPU; i++)
+    if(cpus[i].online)
+      online |= 1L << i;
+  mask &= AFFINITY_ALL;
+  if((mask & online) == 0)
+    return -1;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      p->affinity = mask;
+      // if it is running on a hart it may no longer use, move it now.
+      int away = (p->state == RUNNING && (mask & (1L << p->last_cpu)) == 0);
+      if(away && p != myproc()){
+        push_off();
+        send_ipi(p->last_cpu);
+        pop_off();
+      }
+      release(&p->lock);
+      if(away && p == myproc())
+        yield();
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Move process pid (0 for the caller) into scheduling class cls.
+// A process entering the fair class starts at min_vruntime, so it
+// neither owes nor is owed CPU time. In the RT class, priority is the
+// static RT level. Returns 0, or -1 on error.
+int
+setclass(int pid, int cls)
+{
+  struct proc *p;
+
+  if(cls != HAI_SCHED_MLFQ && cls != HAI_SCHED_FAIR && cls != HAI_SCHED_RT)
+    return -1;
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      if(p->sched_class != cls){
+        p->sched_class = cls;
+        if(cls == HAI_SCHED_FAIR){
+          p->vruntime = 0;
+          fair_place(p, 0);
+        }
+        p->budget = proc_slice(p);
+      }
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Set the run-delay bound of process pid (0 for the caller) to usec
+// microseconds (0 clears it). Each dispatch that comes later than
+// that after the process became RUNNABLE counts as a deadline miss.
+int
+setdeadline(int pid, int usec)
+{
+  struct proc *p;
+
+  if(usec < 0)
+    return -1;
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      p->deadline = (uint64)usec * CYCLES_PER_US;
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Return the scheduling class of process pid (0 for the caller), or -1.
+int
+getclass(int pid)
+{
+  struct proc *p;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      int cls = p->sched_class;
+      release(&p->lock);
+      return cls;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// Return the hart mask of process pid (0 for the caller), or -1.
+int
+getaffinity(int pid)
+{
+  struct proc *p;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  for(p = proc; p < &proc[NPROC]; p++){
+    acquire(&p->lock);
+    if(p->pid == pid && p->state != UNUSED){
+      int mask = p->affinity;
+      release(&p->lock);
+      return mask;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
 int
 getpriority(int pid)
 {
@@ -24,6 +24,12 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  int idle;                   // In scheduler() looking for work; IPI wakes it.
+  int run_prio;               // Rank of proc, for wakeup preemption.
+  int online;                 // Has entered scheduler(); valid affinity target.
+  uint64 next_tick;           // r_time() of this hart's next clock tick.
+  uint64 alarm;               // r_time() to wake alarm_chan at, 0 if none.
+  void *alarm_chan;
 };
 
 extern struct cpu cpus[NCPU];
@@ -98,6 +104,22 @@ struct proc {
   uint64 rtime;               // total runtime ticks 已运行的 tick 数
   uint64 sched_cnt;           // how many times scheduled 被调度次数
   uint64 sched_stamp;         // when it became RUNNABLE, for fairness
+  uint64 wake_stamp;          // r_time() at wakeup(), for wakeup latency
+  uint64 nvcsw;               // voluntary context switches (sleep)
+  uint64 nivcsw;              // involuntary context switches (preempted)
+  uint64 affinity;            // harts it may run on, bit i = hart i
+  int last_cpu;               // hart it last ran on, -1 if never ran
+  uint64 migrations;          // dispatches on a hart other than last_cpu
+  int sched_class;            // HAI_SCHED_MLFQ / _FAIR / _RT
+  uint64 vruntime;            // FAIR: cputime scaled by 1024/weight
+  uint64 cputime;             // r_time() cycles spent RUNNING
+  uint64 run_start;           // r_time() when last dispatched
+  uint64 queued_at;           // r_time() when it last became RUNNABLE
+  uint64 rundelay[SCHED_LAT_BUCKETS]; // RUNNABLE-to-RUNNING delays
+  uint64 rundelay_sum;        // cycles spent RUNNABLE
+  uint64 rundelay_max;        // longest RUNNABLE wait
+  uint64 deadline;            // run-delay bound in cycles, 0 = none
+  uint64 deadline_misses;     // dispatches that exceeded it
   uint64 page_faults;         // 用户态懒分配命中的缺页次数
 
   // wait_lock must be held when using this:
@@ -112,4 +134,6 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  void (*kfn)(void);           // kernel process body (kproc_create)
+  int logres;                  // log blocks reserved by begin_op()
 };
@@ -62,6 +62,7 @@ w_sstatus(uint64 x)
 }
 
 // Supervisor Interrupt Pending
+#define SIP_SSIP (1L << 1) // software (IPI forwarded by mswivec)
 static inline uint64
 r_sip()
 {
@@ -79,6 +80,7 @@ w_sip(uint64 x)
 // Supervisor Interrupt Enable
 #define SIE_SEIE (1L << 9) // external
 #define SIE_STIE (1L << 5) // timer
+#define SIE_SSIE (1L << 1) // software
 static inline uint64
 r_sie()
 {
@@ -95,6 +97,7 @@ w_sie(uint64 x)
 
 // Machine-mode Interrupt Enable
 #define MIE_STIE (1L << 5)  // supervisor timer
+#define MIE_MSIE (1L << 3)  // machine software (CLINT msip)
 static inline uint64
 r_mie()
 {
@@ -156,6 +159,20 @@ w_mideleg(uint64 x)
   asm volatile("csrw mideleg, %0" : : "r" (x));
 }
 
+// Machine-mode interrupt vector
+static inline void 
+w_mtvec(uint64 x)
+{
+  asm volatile("csrw mtvec, %0" : : "r" (x));
+}
+
+// Machine-mode scratch register, used by mswivec.
+static inline void 
+w_mscratch(uint64 x)
+{
+  asm volatile("csrw mscratch, %0" : : "r" (x));
+}
+
 // Supervisor Trap-Vector Base Address
 // low two bits are mode.
 static inline void 
@@ -5,5 +5,9 @@ struct spinlock {
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+
+  // Contention statistics, updated while held.
+  uint64 nacquire;   // times acquired
+  uint64 nspin;      // failed test-and-set attempts before acquiring
 };
 
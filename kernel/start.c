@@ -6,10 +6,18 @@
 
 void main();
 void timerinit();
+void ipiinit();
+
+// in kernelvec.S, forwards CLINT software interrupts to supervisor mode.
+void mswivec();
 
 // entry.S needs one stack per CPU.
 __attribute__ ((aligned (16))) char stack0[4096 * NCPU];
 
+// per-hart scratch area for mswivec: two saved registers
+// and the address of the hart's CLINT msip word.
+uint64 mscratch0[NCPU * 4];
+
 extern char __bss_start[];
 extern char __bss_end[];
 
@@ -43,7 +51,7 @@ start()
   // delegate all interrupts and exceptions to supervisor mode.
   w_medeleg(0xffff);
   w_mideleg(0xffff);
-  w_sie(r_sie() | SIE_SEIE | SIE_STIE);
+  w_sie(r_sie() | SIE_SEIE | SIE_STIE | SIE_SSIE);
 
   // configure Physical Memory Protection to give supervisor mode
   // access to all of physical memory.
@@ -53,6 +61,9 @@ start()
   // ask for clock interrupts.
   timerinit();
 
+  // accept inter-processor interrupts from other harts.
+  ipiinit();
+
   // keep each CPU's hartid in its tp register, for cpuid().
   int id = r_mhartid();
   w_tp(id);
@@ -77,3 +88,19 @@ timerinit()
   // ask for the very first timer interrupt.
   w_stimecmp(r_time() + 1000000);
 }
+
+// route this hart's CLINT software interrupt to mswivec, which
+// re-raises it as a supervisor software interrupt for devintr().
+void
+ipiinit()
+{
+  int id = r_mhartid();
+  uint64 *scratch = &mscratch0[4 * id];
+  scratch[2] = CLINT_MSIP(id);
+  w_mscratch((uint64)scratch);
+
+  w_mtvec((uint64)mswivec);
+
+  // enable machine-mode software interrupts.
+  w_mie(r_mie() | MIE_MSIE);
+}
@@ -114,6 +114,15 @@ extern uint64 sys_eventfd(void);
 extern uint64 sys_timerfd(void);
 extern uint64 sys_devinfo(void);
 extern uint64 sys_dmesg(void);
+extern uint64 sys_sched_setaffinity(void);
+extern uint64 sys_sched_getaffinity(void);
+extern uint64 sys_sched_setclass(void);
+extern uint64 sys_sched_getclass(void);
+extern uint64 sys_procsnap(void);
+extern uint64 sys_sched_setdeadline(void);
+extern uint64 sys_logcrash(void);
+extern uint64 sys_fsync(void);
+extern uint64 sys_fdatasync(void);
 
 // An array mapping syscall numbers from syscall.h
 // to the function that handles the system call.
@@ -152,6 +161,15 @@ static uint64 (*syscalls[])(void) = {
 [SYS_timerfd] sys_timerfd,
 [SYS_devinfo] sys_devinfo,
 [SYS_dmesg]   sys_dmesg,
+[SYS_sched_setaffinity] sys_sched_setaffinity,
+[SYS_sched_getaffinity] sys_sched_getaffinity,
+[SYS_sched_setclass] sys_sched_setclass,
+[SYS_sched_getclass] sys_sched_getclass,
+[SYS_procsnap] sys_procsnap,
+[SYS_sched_setdeadline] sys_sched_setdeadline,
+[SYS_logcrash] sys_logcrash,
+[SYS_fsync]   sys_fsync,
+[SYS_fdatasync] sys_fdatasync,
 };
 
 void
@@ -33,3 +33,12 @@
 #define SYS_timerfd 32
 #define SYS_devinfo 33
 #define SYS_dmesg 34
+#define SYS_sched_setaffinity 35
+#define SYS_sched_getaffinity 36
+#define SYS_sched_setclass 37
+#define SYS_sched_getclass 38
+#define SYS_procsnap 39
+#define SYS_sched_setdeadline 40
+#define SYS_logcrash 41
+#define SYS_fsync 42
+#define SYS_fdatasync 43
@@ -47,6 +47,19 @@ sys_statfs(void)
   return 0;
 }
 
+// logcrash: arm a simulated power failure in the log (LOGCRASH_*),
+// for the crash tests.
+uint64
+sys_logcrash(void)
+{
+  int pt;
+  argint(0, &pt);
+  if(pt < LOGCRASH_TORN || pt > LOGCRASH_INSTALL)
+    return -1;
+  log_crash(pt);
+  return 0;
+}
+
 // Allocate a file descriptor for the given file.
 // Takes over file reference from caller on success.
 static int
@@ -133,6 +146,26 @@ sys_fstat(void)
   return filestat(f, st);
 }
 
+// fsync/fdatasync: make the file's writes durable. File data and
+// metadata share the log, so both force the whole log.
+uint64
+sys_fsync(void)
+{
+  struct file *f;
+
+  if(argfd(0, 0, &f) < 0)
+    return -1;
+  if(f->type == FD_INODE)
+    log_force();
+  return 0;
+}
+
+uint64
+sys_fdatasync(void)
+{
+  return sys_fsync();
+}
+
 // Create the path new as a link to the same inode as old.
 uint64
 sys_link(void)
@@ -143,7 +176,7 @@ sys_link(void)
   if(argstr(0, old, MAXPATH) < 0 || argstr(1, new, MAXPATH) < 0)
     return -1;
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
   if((ip = namei(old)) == 0){
     end_op();
     return -1;
@@ -210,7 +243,7 @@ sys_unlink(void)
   if(argstr(0, path, MAXPATH) < 0)
     return -1;
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
   if((dp = nameiparent(path, name)) == 0){
     end_op();
     return -1;
@@ -328,7 +361,7 @@ sys_open(void)
   if((n = argstr(0, path, MAXPATH)) < 0)
     return -1;
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
 
   if(omode & O_CREATE){
     ip = create(path, T_FILE, 0, 0);
@@ -369,10 +402,12 @@ sys_open(void)
   } else {
     f->type = FD_INODE;
     f->off = 0;
+    f->ra_last = f->ra_win = f->ra_end = 0;
   }
   f->ip = ip;
   f->readable = !(omode & O_WRONLY);
   f->writable = (omode & O_WRONLY) || (omode & O_RDWR);
+  f->sync = (omode & O_SYNC) != 0;
 
   if((omode & O_TRUNC) && ip->type == T_FILE){
     itrunc(ip);
@@ -390,7 +425,7 @@ sys_mkdir(void)
   char path[MAXPATH];
   struct inode *ip;
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
   if(argstr(0, path, MAXPATH) < 0 || (ip = create(path, T_DIR, 0, 0)) == 0){
     end_op();
     return -1;
@@ -407,7 +442,7 @@ sys_mknod(void)
   char path[MAXPATH];
   int major, minor;
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
   argint(1, &major);
   argint(2, &minor);
   if((argstr(0, path, MAXPATH)) < 0 ||
@@ -427,7 +462,7 @@ sys_chdir(void)
   struct inode *ip;
   struct proc *p = myproc();
   
-  begin_op();
+  begin_op(MAXOPBLOCKS);
   if(argstr(0, path, MAXPATH) < 0 || (ip = namei(path)) == 0){
     end_op();
     return -1;
@@ -525,7 +560,7 @@ sys_fverify(void)
   char path[MAXPATH];
   struct inode *ip;
 
-  begin_op();
+  begin_op(MAXOPBLOCKS);
   if(argstr(0, path, MAXPATH) < 0 || (ip = namei(path)) == 0){
     end_op();
     return -1;
@@ -115,6 +115,50 @@ sys_getpriority(void)
   return getpriority(pid);
 }
 
+uint64
+sys_sched_setaffinity(void)
+{
+  int pid;
+  uint64 mask;
+  argint(0, &pid);
+  argaddr(1, &mask);
+  return setaffinity(pid, mask);
+}
+
+uint64
+sys_sched_getaffinity(void)
+{
+  int pid;
+  argint(0, &pid);
+  return getaffinity(pid);
+}
+
+uint64
+sys_sched_setclass(void)
+{
+  int pid, cls;
+  argint(0, &pid);
+  argint(1, &cls);
+  return setclass(pid, cls);
+}
+
+uint64
+sys_sched_getclass(void)
+{
+  int pid;
+  argint(0, &pid);
+  return getclass(pid);
+}
+
+uint64
+sys_sched_setdeadline(void)
+{
+  int pid, usec;
+  argint(0, &pid);
+  argint(1, &usec);
+  return setdeadline(pid, usec);
+}
+
 uint64
 sys_klogctl(void)
 {
@@ -175,23 +219,53 @@ fill_procinfo(struct hai_procinfo *dst, struct proc *p)
   dst->rtime = p->rtime;
   dst->sched_cnt = p->sched_cnt;
   dst->page_faults = p->page_faults;
+  dst->nvcsw = p->nvcsw;
+  dst->nivcsw = p->nivcsw;
+  dst->affinity = p->affinity;
+  dst->migrations = p->migrations;
+  dst->last_cpu = p->last_cpu;
+  dst->sched_class = p->sched_class;
+  dst->weight = fair_weight_of(p->priority);
+  dst->vruntime = p->vruntime;
+  dst->cputime = p->cputime;
+  if(p->state == RUNNING)
+    dst->cputime += r_time() - p->run_start; // current turn so far
+  memmove(dst->rundelay, p->rundelay, sizeof(dst->rundelay));
+  dst->rundelay_sum = p->rundelay_sum;
+  dst->rundelay_max = p->rundelay_max;
+  dst->deadline = p->deadline;
+  dst->deadline_misses = p->deadline_misses;
   safestrcpy(dst->name, p->name, sizeof(dst->name));
 }
 
+// schedinfo: system-wide scheduler counters. Per-process entries
+// come from procsnap().
 uint64
 sys_schedinfo(void)
 {
   uint64 uaddr;
   struct hai_schedinfo info;
-  memset(&info, 0, sizeof(info));
   argaddr(0, &uaddr);
 
+  memset(&info, 0, sizeof(info));
+
   info.ticks = ticks;
 
   struct proc *p;
-  int idx = 0;
+  uint64 vmin = ~0UL, vmax = 0;
   for(p = proc; p < &proc[NPROC]; p++){
     acquire(&p->lock);
+    if(p->state != UNUSED && p->sched_class == HAI_SCHED_RT)
+      info.nrt++;
+    if(p->state != UNUSED && p->sched_class == HAI_SCHED_FAIR){
+      info.nfair++;
+      if(p->state == RUNNABLE || p->state == RUNNING){
+        if(p->vruntime < vmin)
+          vmin = p->vruntime;
+        if(p->vruntime > vmax)
+          vmax = p->vruntime;
+      }
+    }
     switch(p->state){
       case RUNNABLE: info.runnable++; break;
       case RUNNING:  info.running++; break;
@@ -200,19 +274,57 @@ sys_schedinfo(void)
       case USED:     info.used++; break;
       default: break;
     }
-    if(p->state != UNUSED && idx < HAI_MAX_PROCSNAPSHOT){
-      fill_procinfo(&info.procs[idx], p);
-      idx++;
-    }
     release(&p->lock);
   }
-  info.nreturned = idx;
+  if(vmax >= vmin)
+    info.vruntime_spread = vmax - vmin;
+  sched_stats(&info);
 
   if(copyout(myproc()->pagetable, uaddr, (char*)&info, sizeof(info)) < 0)
     return -1;
   return 0;
 }
 
+// procsnap(int *cursor, struct hai_procinfo *buf, int max):
+// copy up to max live processes, starting at proc table slot
+// *cursor, into buf, and advance *cursor past the last slot
+// examined. Returns the number copied; 0 once the table is done.
+uint64
+sys_procsnap(void)
+{
+  uint64 ucursor, ubuf;
+  int cursor, max, n = 0;
+  struct hai_procinfo pi;
+  struct proc *p;
+  pagetable_t pt = myproc()->pagetable;
+
+  argaddr(0, &ucursor);
+  argaddr(1, &ubuf);
+  argint(2, &max);
+  if(copyin(pt, (char*)&cursor, ucursor, sizeof(cursor)) < 0)
+    return -1;
+  if(cursor < 0 || max < 0)
+    return -1;
+
+  for(; cursor < NPROC && n < max; cursor++){
+    p = &proc[cursor];
+    acquire(&p->lock);
+    if(p->state == UNUSED){
+      release(&p->lock);
+      continue;
+    }
+    fill_procinfo(&pi, p);
+    release(&p->lock);
+    if(copyout(pt, ubuf + n * sizeof(pi), (char*)&pi, sizeof(pi)) < 0)
+      return -1;
+    n++;
+  }
+
+  if(copyout(pt, ucursor, (char*)&cursor, sizeof(cursor)) < 0)
+    return -1;
+  return n;
+}
+
 uint64
 sys_vmstat(void)
 {
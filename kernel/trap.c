@@ -83,11 +83,13 @@ usertrap(void)
   if(killed(p))
     kexit(-1);
 
-  // 时钟中断：先记账，再让出 CPU 触发调度。
-  if(which_dev == 2){
-    proc_tick();
+  // 时钟中断：先记账；仅在时间片耗尽或有更高优先级进程等待时让出 CPU。
+  if(which_dev == 2 && proc_tick())
+    yield();
+
+  // 其他 hart 的 wakeup() 发来 IPI：有更高优先级进程等待运行。
+  if(which_dev == 3)
     yield();
-  }
 
   prepare_return();
 
@@ -156,8 +158,12 @@ kerneltrap()
     panic("kerneltrap");
   }
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2 && myproc() != 0)
+  // give up the CPU if this timer tick used up the process's
+  // slice or a higher-priority process is waiting, or on a
+  // reschedule IPI from wakeup().
+  if(which_dev == 2 && myproc() != 0 && proc_tick())
+    yield();
+  else if(which_dev == 3 && myproc() != 0)
     yield();
 
   // the yield() may have caused some traps to occur,
@@ -166,25 +172,54 @@ kerneltrap()
   w_sstatus(sstatus);
 }
 
+// Wake chan from this hart's timer at about r_time() == when, for
+// waits much shorter than a tick. A hart has one alarm; a later
+// call replaces it. Caller has interrupts off.
 void
+alarm_at(uint64 when, void *chan)
+{
+  struct cpu *c = mycpu();
+
+  c->alarm = when;
+  c->alarm_chan = chan;
+  if(when < r_stimecmp())
+    w_stimecmp(when);
+}
+
+// Returns 1 if this interrupt was a clock tick, 0 if it was
+// only an alarm.
+int
 clockintr()
 {
-  if(cpuid() == 0){
-    acquire(&tickslock);
-    ticks++;
-    wakeup(&ticks);
-    release(&tickslock);
+  struct cpu *c = mycpu();
+  uint64 now = r_time();
+  int tick = now >= c->next_tick;
+
+  if(tick){
+    if(cpuid() == 0){
+      acquire(&tickslock);
+      ticks++;
+      wakeup(&ticks);
+      release(&tickslock);
+    }
+    // 1000000 is about a tenth of a second.
+    c->next_tick = now + 1000000;
+  }
+  if(c->alarm && now >= c->alarm){
+    c->alarm = 0;
+    wakeup(c->alarm_chan);
   }
 
   // ask for the next timer interrupt. this also clears
-  // the interrupt request. 1000000 is about a tenth
-  // of a second.
-  w_stimecmp(r_time() + 1000000);
+  // the interrupt request.
+  w_stimecmp(c->alarm && c->alarm < c->next_tick ? c->alarm : c->next_tick);
+  return tick;
 }
 
 // check if it's an external interrupt or software interrupt,
 // and handle it.
-// returns 2 if timer interrupt,
+// returns 3 if reschedule IPI,
+// 2 if timer interrupt,
 // 1 if other device,
 // 0 if not recognized.
 int
@@ -214,9 +249,13 @@ devintr()
 
     return 1;
   } else if(scause == 0x8000000000000005L){
-    // timer interrupt.
-    clockintr();
-    return 2;
+    // timer interrupt; an alarm alone is not a tick.
+    return clockintr() ? 2 : 1;
+  } else if(scause == 0x8000000000000001L){
+    // supervisor software interrupt: a reschedule IPI
+    // forwarded by mswivec in kernelvec.S.
+    ipi_intr();
+    return 3;
   } else {
     return 0;
   }
@@ -49,6 +49,8 @@ static struct disk {
   struct {
     struct buf *b;
     char status;
+    char async;   // nobody waits; virtio_disk_intr() hands b back to bio
+    char batch;   // virtio_disk_intr() frees the chain, then wakes b
   } info[NUM];
 
   // disk command headers.
@@ -205,12 +207,12 @@ free_chain(int i)
   }
 }
 
-// allocate three descriptors (they need not be contiguous).
-// disk transfers always use three descriptors.
+// allocate n descriptors (they need not be contiguous).
+// a transfer of k blocks uses k+2: header, k data, status.
 static int
-alloc3_desc(int *idx)
+alloc_descs(int *idx, int n)
 {
-  for(int i = 0; i < 3; i++){
+  for(int i = 0; i < n; i++){
     idx[i] = alloc_desc();
     if(idx[i] < 0){
       for(int j = 0; j < i; j++)
@@ -221,27 +223,21 @@ alloc3_desc(int *idx)
   return 0;
 }
 
-void
-virtio_disk_rw(struct buf *b, int write)
+// fill in the n+2 descriptors idx[] for a transfer of the n
+// consecutive blocks in bs[], and hand the chain to the device.
+// bs[0] is the buf virtio_disk_intr() marks done.
+// caller holds vdisk_lock.
+static void
+virtio_disk_submit(struct buf **bs, int n, int write, int *idx)
 {
-  uint64 sector = b->blockno * (BSIZE / 512);
-
-  acquire(&disk.vdisk_lock);
+  uint64 sector = bs[0]->blockno * (BSIZE / 512);
 
   // the spec's Section 5.2 says that legacy block operations use
-  // three descriptors: one for type/reserved/sector, one for the
-  // data, one for a 1-byte status result.
+  // a header descriptor for type/reserved/sector, then the data,
+  // which may be split over several descriptors, then a 1-byte
+  // status result.
 
-  // allocate the three descriptors.
-  int idx[3];
-  while(1){
-    if(alloc3_desc(idx) == 0) {
-      break;
-    }
-    sleep(&disk.free[0], &disk.vdisk_lock);
-  }
-
-  // format the three descriptors.
+  // format the descriptors.
   // qemu's virtio-blk.c reads them.
 
   struct virtio_blk_req *buf0 = &disk.ops[idx[0]];
@@ -258,24 +254,28 @@ virtio_disk_rw(struct buf *b, int write)
   disk.desc[idx[0]].flags = VRING_DESC_F_NEXT;
   disk.desc[idx[0]].next = idx[1];
 
-  disk.desc[idx[1]].addr = (uint64) b->data;
-  disk.desc[idx[1]].len = BSIZE;
-  if(write)
-    disk.desc[idx[1]].flags = 0; // device reads b->data
-  else
-    disk.desc[idx[1]].flags = VRING_DESC_F_WRITE; // device writes b->data
-  disk.desc[idx[1]].flags |= VRING_DESC_F_NEXT;
-  disk.desc[idx[1]].next = idx[2];
+  for(int i = 0; i < n; i++){
+    int d = idx[1+i];
+    disk.desc[d].addr = (uint64) bs[i]->data;
+    disk.desc[d].len = BSIZE;
+    if(write)
+      disk.desc[d].flags = 0; // device reads b->data
+    else
+      disk.desc[d].flags = VRING_DESC_F_WRITE; // device writes b->data
+    disk.desc[d].flags |= VRING_DESC_F_NEXT;
+    disk.desc[d].next = idx[2+i];
+  }
 
+  int st = idx[n+1];
   disk.info[idx[0]].status = 0xff; // device writes 0 on success
-  disk.desc[idx[2]].addr = (uint64) &disk.info[idx[0]].status;
-  disk.desc[idx[2]].len = 1;
-  disk.desc[idx[2]].flags = VRING_DESC_F_WRITE; // device writes the status
-  disk.desc[idx[2]].next = 0;
+  disk.desc[st].addr = (uint64) &disk.info[idx[0]].status;
+  disk.desc[st].len = 1;
+  disk.desc[st].flags = VRING_DESC_F_WRITE; // device writes the status
+  disk.desc[st].next = 0;
 
   // record struct buf for virtio_disk_intr().
-  b->disk = 1;
-  disk.info[idx[0]].b = b;
+  bs[0]->disk = 1;
+  disk.info[idx[0]].b = bs[0];
 
   // tell the device the first index in our chain of descriptors.
   disk.avail->ring[disk.avail->idx % NUM] = idx[0];
@@ -298,10 +298,35 @@ virtio_disk_rw(struct buf *b, int write)
     disk.writes++;
   else
     disk.reads++;
+}
+
+// Read or write the n blocks bs[0..n-1], which must be
+// consecutive on disk, in a single request.
+void
+virtio_disk_rw_range(struct buf **bs, int n, int write)
+{
+  int idx[MAXRANGE+2];
+
+  if(n < 1 || n > MAXRANGE)
+    panic("virtio_disk_rw_range");
+
+  acquire(&disk.vdisk_lock);
+
+  // allocate the descriptors.
+  while(1){
+    if(alloc_descs(idx, n+2) == 0) {
+      break;
+    }
+    sleep(&disk.free[0], &disk.vdisk_lock);
+  }
+
+  disk.info[idx[0]].async = 0;
+  disk.info[idx[0]].batch = 0;
+  virtio_disk_submit(bs, n, write, idx);
 
   // Wait for virtio_disk_intr() to say request has finished.
-  while(b->disk == 1) {
-    sleep(b, &disk.vdisk_lock);
+  while(bs[0]->disk == 1) {
+    sleep(bs[0], &disk.vdisk_lock);
   }
 
   disk.info[idx[0]].b = 0;
@@ -310,6 +335,65 @@ virtio_disk_rw(struct buf *b, int write)
   release(&disk.vdisk_lock);
 }
 
+// Read or write bs[0..n-1], in any block order. Each stretch of
+// consecutive blocks (up to MAXRANGE) becomes one request, and
+// all of them are handed to the device before waiting, as far as
+// descriptors allow. Returns once every request has finished.
+void
+virtio_disk_rw_batch(struct buf **bs, int n, int write)
+{
+  int idx[MAXRANGE+2];
+  int i, k;
+
+  acquire(&disk.vdisk_lock);
+
+  for(i = 0; i < n; i += k){
+    for(k = 1; i + k < n && k < MAXRANGE &&
+        bs[i+k]->blockno == bs[i+k-1]->blockno + 1; k++)
+      ;
+    while(alloc_descs(idx, k+2) < 0)
+      sleep(&disk.free[0], &disk.vdisk_lock);
+    disk.info[idx[0]].async = 0;
+    disk.info[idx[0]].batch = 1;
+    virtio_disk_submit(bs + i, k, write, idx);
+  }
+
+  // only the first buf of each request had b->disk set.
+  for(i = 0; i < n; i++){
+    while(bs[i]->disk == 1)
+      sleep(bs[i], &disk.vdisk_lock);
+  }
+
+  release(&disk.vdisk_lock);
+}
+
+void
+virtio_disk_rw(struct buf *b, int write)
+{
+  virtio_disk_rw_range(&b, 1, write);
+}
+
+// Start reading b without waiting for it; for readahead.
+// b must be locked; virtio_disk_intr() passes it to
+// bio_async_done() when the data is in.
+// Returns -1, and starts nothing, if the ring is full.
+int
+virtio_disk_read_async(struct buf *b)
+{
+  int idx[3];
+
+  acquire(&disk.vdisk_lock);
+  if(alloc_descs(idx, 3) < 0){
+    release(&disk.vdisk_lock);
+    return -1;
+  }
+  disk.info[idx[0]].async = 1;
+  disk.info[idx[0]].batch = 0;
+  virtio_disk_submit(&b, 1, 0, idx);
+  release(&disk.vdisk_lock);
+  return 0;
+}
+
 void
 virtio_disk_intr()
 {
@@ -337,7 +421,19 @@ virtio_disk_intr()
 
     struct buf *b = disk.info[id].b;
     b->disk = 0;   // disk is done with buf
-    wakeup(b);
+    if(disk.info[id].async){
+      disk.info[id].b = 0;
+      disk.info[id].async = 0;
+      free_chain(id);
+      bio_async_done(b);
+    } else {
+      if(disk.info[id].batch){
+        disk.info[id].b = 0;
+        disk.info[id].batch = 0;
+        free_chain(id);
+      }
+      wakeup(b);
+    }
 
     if(disk.inflight > 0)
       disk.inflight--;
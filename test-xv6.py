@@ -7,6 +7,7 @@
 # ./test-xv6.py -q usertests (runs the quick tests of usertests)
 # ./test-xv6.py crash  (runs the crash tests)
 # ./test-xv6.py log (runs the log crash test)
+# ./test-xv6.py logcrash (runs the log crash-injection tests)
 
 import argparse, os, inspect, re, signal, subprocess, sys, time
 from subprocess import run
@@ -169,6 +170,31 @@ def test_log():
     print("FAIL")
     sys.exit(1)
     
+def logcrash(point):
+    q = QEMU(True)
+    q.cmd("logcrash %d\n" % point)
+    time.sleep(3)
+    q.read()
+    q.match('.*logcrash: stopped at point %d' % point)
+    q.crash()
+    q.stop()
+
+def recover_logcrash(want):
+    q = QEMU()
+    time.sleep(2)
+    q.cmd("logcrash check\n")
+    time.sleep(2)
+    q.read()
+    q.match('^logcrash: lc is all %s' % want)
+    q.stop()
+
+def test_logcrash():
+    print("Test recovery of torn, committed, and half-installed transactions")
+    for point, want in ((1, 'a'), (2, 'b'), (3, 'b')):
+        logcrash(point)
+        recover_logcrash(want)
+    print("OK")
+
 def test_forphan():
     print("Test recovery of an orphaned file")
     forphan()
@@ -183,6 +209,7 @@ def test_dorphan():
 
 def test_crash():
     test_log()
+    test_logcrash()
     test_forphan()
     test_dorphan()
 
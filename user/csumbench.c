@@ -0,0 +1,78 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Hai-OS 校验和吞吐：在用户态反复对一块 64 KiB 缓冲区运行内核的
+// 校验和代码（kernel/checksum.c 同时链接进本程序），每种算法至少
+// 跑 [ticks] 个 tick，报告 MB/s。adler32-byte 是旧的逐字节取模
+// 实现，作为对照。
+//
+// usage: csumbench [ticks]
+
+#define TICKS_PER_SEC 10
+#define BUFSZ (64*1024)
+
+void csum_init(void);
+uint adler32_update(uint, const uchar*, int);
+uint crc32c_update(uint, const uchar*, int);
+
+static uchar buf[BUFSZ];
+
+static uint
+adler32_byte(uint adler, const uchar *data, int len)
+{
+  uint a = adler & 0xffff, b = (adler >> 16) & 0xffff;
+  for(int i = 0; i < len; i++){
+    a = (a + data[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+static uint
+crc32c(uint crc, const uchar *p, int len)
+{
+  return ~crc32c_update(~crc, p, len);
+}
+
+struct alg {
+  char *name;
+  uint (*fn)(uint, const uchar*, int);
+  uint init;
+} algs[] = {
+  { "adler32-byte", adler32_byte,   1 },
+  { "adler32",      adler32_update, 1 },
+  { "crc32c",       crc32c,         0 },
+};
+
+int
+main(int argc, char **argv)
+{
+  int ticks = 20;
+
+  if(argc > 1)
+    ticks = atoi(argv[1]);
+  if(ticks < 1){
+    fprintf(2, "usage: csumbench [ticks]\n");
+    exit(1);
+  }
+
+  csum_init();
+  for(int i = 0; i < BUFSZ; i++)
+    buf[i] = i * 7 + (i >> 8);
+
+  printf("ALG          SUM        MB/s\n");
+  for(int a = 0; a < sizeof(algs)/sizeof(algs[0]); a++){
+    uint sum = algs[a].init;
+    uint64 bytes = 0;
+    int t0 = uptime(), t;
+    while((t = uptime() - t0) < ticks){
+      sum = algs[a].fn(sum, buf, BUFSZ);
+      bytes += BUFSZ;
+    }
+    uint64 kbs = bytes / 1024 * TICKS_PER_SEC / t;
+    printf("%-12s 0x%08x %lu.%02lu\n", algs[a].name, sum,
+           kbs / 1024, kbs % 1024 * 100 / 1024);
+  }
+  exit(0);
+}
@@ -0,0 +1,122 @@
+#include "kernel/param.h"
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/hai_sysinfo.h"
+#include "user/user.h"
+
+// Hai-OS 调度公平性基准：每个优先级起一个 CPU 密集进程，再加一个
+// 频繁睡眠的低优先级进程（MLFQ 下会靠唤醒提升"作弊"），运行若干
+// tick 后按 procsnap 的 cputime 统计实际份额与按权重应得的份额。
+// 可与 grind/forktest 同时运行以比较两种调度类。
+//
+// usage: fairbench [mlfq|fair] [ticks]
+
+#define NHOG PRI_LEVELS
+#define CYCLES_PER_MS 10000
+
+static void
+spin(void)
+{
+  volatile uint64 x = 0;
+  for(;;)
+    x++;
+}
+
+// burn a few ms, then sleep a tick, forever.
+static void
+gamer(void)
+{
+  volatile uint64 x = 0;
+  for(;;){
+    for(int i = 0; i < 200000; i++)
+      x++;
+    pause(1);
+  }
+}
+
+static int
+start(int cls, int prio, void (*fn)(void))
+{
+  int pid = fork();
+  if(pid < 0){
+    fprintf(2, "fairbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    setpriority(getpid(), prio);
+    sched_setclass(0, cls);
+    fn();
+  }
+  return pid;
+}
+
+int
+main(int argc, char **argv)
+{
+  int cls = HAI_SCHED_FAIR;
+  int run = 300;
+  int pids[NHOG + 1];
+  static struct hai_procinfo procs[NPROC];
+
+  if(argc > 1){
+    if(strcmp(argv[1], "mlfq") == 0)
+      cls = HAI_SCHED_MLFQ;
+    else if(strcmp(argv[1], "fair") != 0){
+      fprintf(2, "usage: fairbench [mlfq|fair] [ticks]\n");
+      exit(1);
+    }
+  }
+  if(argc > 2 && atoi(argv[2]) > 0)
+    run = atoi(argv[2]);
+
+  // stay ahead of the hogs so the snapshot is taken on time.
+  setpriority(getpid(), PRI_MAX);
+
+  for(int i = 0; i < NHOG; i++)
+    pids[i] = start(cls, i, spin);
+  pids[NHOG] = start(cls, 0, gamer);
+
+  pause(run);
+  int n = 0, cursor = 0, got;
+  while(n < NPROC && (got = procsnap(&cursor, procs + n, NPROC - n)) > 0)
+    n += got;
+  for(int i = 0; i <= NHOG; i++)
+    kill(pids[i]);
+  for(int i = 0; i <= NHOG; i++)
+    wait(0);
+
+  uint64 cpu[NHOG + 1], total = 0, wsum = 0;
+  int weight[NHOG + 1];
+  for(int i = 0; i <= NHOG; i++){
+    cpu[i] = 0;
+    weight[i] = 1024;
+    for(int j = 0; j < n; j++){
+      if(procs[j].pid == pids[i]){
+        cpu[i] = procs[j].cputime;
+        weight[i] = procs[j].weight;
+      }
+    }
+    if(i < NHOG){
+      total += cpu[i];
+      wsum += weight[i];
+    }
+  }
+
+  printf("fairbench: class=%s ticks=%d\n", cls == HAI_SCHED_FAIR ? "fair" : "mlfq", run);
+  printf("PID  PRIO WEIGHT CPUMS  SHARE TARGET\n");
+  uint64 sum = 0, sumsq = 0;
+  for(int i = 0; i < NHOG; i++){
+    int share = total ? (int)(cpu[i] * 100 / total) : 0;
+    int target = (int)(weight[i] * 100 / wsum);
+    printf("%-4d %-4d %-6d %-6d %-4d%% %d%%\n", pids[i], i, weight[i],
+           (int)(cpu[i] / CYCLES_PER_MS), share, target);
+    uint64 x = cpu[i] / CYCLES_PER_MS * 1024 / weight[i];
+    sum += x;
+    sumsq += x * x;
+  }
+  printf("gamer pid %d (prio 0, sleeps every few ms): cpu=%dms\n",
+         pids[NHOG], (int)(cpu[NHOG] / CYCLES_PER_MS));
+  printf("fairness (Jain, cpu/weight over hogs): %d%%\n",
+         sumsq ? (int)(sum * sum * 100 / (NHOG * sumsq)) : 100);
+  exit(0);
+}
@@ -5,14 +5,52 @@
 
 static void print_statfs(struct hai_statfs *st) {
   printf("Hai-OS FS info:\n");
-  printf(" magic=0x%x ver=%d block=%d checksum=%d\n", st->magic, st->version, st->block_size, st->checksum_alg);
+  printf(" magic=0x%x ver=%d block=%d checksum=%s\n", st->magic, st->version, st->block_size,
+         st->checksum_alg == CSUM_CRC32C ? "crc32c" : "adler32");
   printf(" data_csum=%d size=%d data=%d inodes=%d\n", st->data_csum, st->size_blocks, st->data_blocks, st->inode_count);
   printf(" blocks: used=%d free=%d\n", st->used_blocks, st->free_blocks);
   printf(" inodes: used=%d free=%d\n", st->used_inodes, st->free_inodes);
   printf(" io: reads=%d writes=%d checksum_errors=%d\n", st->io_reads, st->io_writes, st->checksum_errors);
-  printf(" features: journaling=%d checksum=%d quota=%d\n", st->has_journaling, st->has_checksum, st->has_quota);
+  if(st->data_csum == DATA_CSUM_BLOCK)
+    printf(" checksum: blocks verified=%lu\n", st->csum_verified);
+  printf(" features: journaling=%d (%s) checksum=%d quota=%d\n", st->has_journaling,
+         st->journal_mode == JOURNAL_ORDERED ? "ordered" : "full", st->has_checksum, st->has_quota);
   printf(" log: start=%d nblocks=%d segments=%d\n", st->log_start, st->log_nblocks, st->log_segments);
+  printf(" log: pending=%d commits=%lu checkpoints=%lu installed=%lu superseded=%lu space_waits=%lu\n",
+         st->log_pending, st->log_commits, st->log_checkpoints, st->log_installed,
+         st->log_superseded, st->log_space_waits);
+  printf(" log: ops=%lu commit_blocks=%lu commits/s=%d blocks/commit=%d\n",
+         st->log_ops, st->log_commit_blocks, st->log_commits_per_sec,
+         st->log_blocks_per_commit);
+  printf(" log: commit=%s", st->log_lazy_ticks ? "lazy" : "sync");
+  if(st->log_lazy_ticks)
+    printf(" within %d ticks", st->log_lazy_ticks);
+  printf(" forces=%lu\n", st->log_forces);
+  printf(" log: writes=%lu absorbed=%lu (%lu%%)\n", st->log_writes, st->log_absorbed,
+         st->log_writes ? st->log_absorbed * 100 / st->log_writes : 0);
+  printf(" log: commit us by size:");
+  for(int i = 0; i < LOG_LAT_BUCKETS; i++){
+    if(st->log_lat_commits[i])
+      printf(" %d+:%lu", 1 << i, st->log_lat_us[i] / st->log_lat_commits[i]);
+  }
+  printf("\n");
   printf(" quota: start=%d blocks=%d\n", st->quota_start, st->quota_blocks);
+  printf(" bcache: bufs=%d buckets=%d searches=%lu steps=%lu lock_acq=%lu lock_spins=%lu\n",
+         st->bcache_nbuf, st->bcache_buckets, st->bcache_searches, st->bcache_chain_steps,
+         st->bcache_lock_acquires, st->bcache_lock_spins);
+  uint64 refs = st->bcache_hits + st->bcache_misses;
+  printf(" bcache: max=%d hits=%lu misses=%lu hit=%lu%% grows=%lu shrinks=%lu\n",
+         st->bcache_maxbuf, st->bcache_hits, st->bcache_misses,
+         refs ? st->bcache_hits * 100 / refs : 0, st->bcache_grows, st->bcache_shrinks);
+  printf(" bcache: lookups=%lu evictions=%lu writebacks=%lu dev_reads=%lu dev_writes=%lu\n",
+         st->bcache_lookups, st->bcache_evictions, st->bcache_writebacks,
+         st->bcache_dev_reads, st->bcache_dev_writes);
+  printf(" bcache: meta_lookups=%lu meta_hit=%lu%% promotions=%lu\n",
+         st->bcache_meta_lookups,
+         st->bcache_meta_lookups ? st->bcache_meta_hits * 100 / st->bcache_meta_lookups : 0,
+         st->bcache_promotions);
+  printf(" readahead: issued=%lu hits=%lu waste=%lu\n",
+         st->bcache_ra_issued, st->bcache_ra_hits, st->bcache_ra_waste);
 }
 
 int
@@ -0,0 +1,63 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fs.h"
+#include "user/user.h"
+
+// Hai-OS 缓冲区缓存/磁盘 I/O 速率：每隔 interval 个 tick 采样一次
+// statfs，打印这段时间内每秒的查找、命中率、未命中、淘汰、写回
+// 以及真正到达磁盘的读写块数。
+//
+// usage: iostat [interval-ticks] [count]
+
+#define TICKS_PER_SEC 10
+
+// per-second rate of a counter that moved by d over t ticks.
+static uint64
+rate(uint64 d, int t)
+{
+  return t > 0 ? d * TICKS_PER_SEC / t : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  int interval = 10, count = 10;
+  struct hai_statfs a, b;
+
+  if(argc > 1)
+    interval = atoi(argv[1]);
+  if(argc > 2)
+    count = atoi(argv[2]);
+  if(interval < 1 || count < 1){
+    fprintf(2, "usage: iostat [interval-ticks] [count]\n");
+    exit(1);
+  }
+
+  if(statfs(&a) < 0){
+    fprintf(2, "iostat: statfs failed\n");
+    exit(1);
+  }
+  int t0 = uptime();
+  printf("lookup/s   hit%%  miss/s evict/s    wb/s  read/s write/s  bufs\n");
+  for(int i = 0; i < count; i++){
+    pause(interval);
+    statfs(&b);
+    int t1 = uptime();
+    int t = t1 - t0;
+
+    uint64 hits = b.bcache_hits - a.bcache_hits;
+    uint64 misses = b.bcache_misses - a.bcache_misses;
+    printf("%-8lu %5lu%% %7lu %7lu %7lu %7lu %7lu %5d\n",
+           rate(b.bcache_lookups - a.bcache_lookups, t),
+           hits + misses ? hits * 100 / (hits + misses) : 0,
+           rate(misses, t),
+           rate(b.bcache_evictions - a.bcache_evictions, t),
+           rate(b.bcache_writebacks - a.bcache_writebacks, t),
+           rate(b.bcache_dev_reads - a.bcache_dev_reads, t),
+           rate(b.bcache_dev_writes - a.bcache_dev_writes, t),
+           b.bcache_nbuf);
+    a = b;
+    t0 = t1;
+  }
+  exit(0);
+}
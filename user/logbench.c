@@ -0,0 +1,65 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fs.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+// Hai-OS 日志提交延迟：单个进程反复从文件开头覆盖写 1、2、4 …
+// 32 个块，每次 write 独占一个事务（数据块 + inode 块），用
+// statfs 的按事务大小分桶的提交延迟计数给出每种大小的平均提交
+// 时间与每块时间。
+//
+// usage: logbench [rounds]
+
+#define MAXBLOCKS 32
+
+static char buf[MAXBLOCKS * BSIZE];
+
+int
+main(int argc, char **argv)
+{
+  int rounds = 50;
+  struct hai_statfs a, b;
+
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(rounds < 1){
+    fprintf(2, "usage: logbench [rounds]\n");
+    exit(1);
+  }
+
+  memset(buf, 'l', sizeof(buf));
+  printf("logbench: %d rounds per size\n", rounds);
+  printf("BLOCKS TXN-BLOCKS COMMITS US/COMMIT US/BLOCK\n");
+  for(int nb = 1; nb <= MAXBLOCKS; nb *= 2){
+    statfs(&a);
+    for(int r = 0; r < rounds; r++){
+      int fd = open("logbench.tmp", O_CREATE | O_RDWR);
+      if(fd < 0 || write(fd, buf, nb * BSIZE) != nb * BSIZE){
+        fprintf(2, "logbench: write failed\n");
+        exit(1);
+      }
+      close(fd);
+    }
+    statfs(&b);
+
+    // the bucket that saw most of this size's commits.
+    int best = 0;
+    uint64 most = 0;
+    for(int i = 0; i < LOG_LAT_BUCKETS; i++){
+      uint64 c = b.log_lat_commits[i] - a.log_lat_commits[i];
+      if(c > most){
+        most = c;
+        best = i;
+      }
+    }
+    uint64 us = b.log_lat_us[best] - a.log_lat_us[best];
+    uint64 blocks = (b.log_commit_blocks - a.log_commit_blocks);
+    uint64 commits = b.log_commits - a.log_commits;
+    uint64 per = most ? us / most : 0;
+    uint64 txn = commits ? blocks / commits : 0;
+    printf("%-6d %-10lu %-7lu %-9lu %lu\n", nb, txn, most, per, txn ? per / txn : 0);
+  }
+  unlink("logbench.tmp");
+  exit(0);
+}
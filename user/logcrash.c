@@ -0,0 +1,71 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fs.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+// Hai-OS 日志崩溃注入测试，由 test-xv6.py 的 logcrash 测试驱动：
+//   logcrash <1|2|3>  先把文件 lc 写成全 'a' 并提交，再布置崩溃点
+//                     （1 提交写到一半，2 提交已落盘，3 检查点写回
+//                     原位置后、写日志头前），然后用全 'b' 覆盖；
+//                     内核在该点停机，等待 test-xv6.py 杀掉 qemu。
+//   logcrash check    重启恢复后检查 lc 必须全 'a' 或全 'b'。
+
+#define NBLOCKS 8
+
+static char buf[NBLOCKS * BSIZE];
+
+static void
+fill(char c)
+{
+  memset(buf, c, sizeof(buf));
+  int fd = open("lc", O_CREATE | O_RDWR);
+  if(fd < 0 || write(fd, buf, sizeof(buf)) != sizeof(buf)){
+    fprintf(2, "logcrash: write lc failed\n");
+    exit(1);
+  }
+  close(fd);
+}
+
+static int
+check(void)
+{
+  int fd = open("lc", O_RDONLY);
+  if(fd < 0 || read(fd, buf, sizeof(buf)) != sizeof(buf)){
+    printf("logcrash: lc missing or short\n");
+    return 1;
+  }
+  close(fd);
+  for(int i = 1; i < sizeof(buf); i++){
+    if(buf[i] != buf[0] || (buf[0] != 'a' && buf[0] != 'b')){
+      printf("logcrash: lc torn at byte %d\n", i);
+      return 1;
+    }
+  }
+  printf("logcrash: lc is all %c\n", buf[0]);
+  return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  if(argc != 2){
+    fprintf(2, "usage: logcrash 1|2|3|check\n");
+    exit(1);
+  }
+  if(strcmp(argv[1], "check") == 0)
+    exit(check());
+
+  int pt = atoi(argv[1]);
+  fill('a');
+  if(logcrash(pt) < 0){
+    fprintf(2, "logcrash: bad point %s\n", argv[1]);
+    exit(1);
+  }
+  printf("logcrash: armed %d\n", pt);
+  fill('b');
+  // point 3 stops the checkpointer, not this write.
+  printf("logcrash: wait for kill\n");
+  for(;;)
+    pause(1000);
+}
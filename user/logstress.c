@@ -1,6 +1,7 @@
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "kernel/fcntl.h"
+#include "kernel/fs.h"
 #include "user/user.h"
 
 // Stress xv6 logging system by having several processes writing
@@ -15,7 +16,10 @@ main(int argc, char **argv)
 {
   int fd, n;
   enum { N = 250, SZ=2000 };
-  
+  struct hai_statfs a, b;
+
+  statfs(&a);
+  int t0 = uptime();
   for (int i = 1; i < argc; i++){
     int pid1 = fork();
     if(pid1 < 0){
@@ -44,5 +48,15 @@ main(int argc, char **argv)
     if(xstatus != 0)
       exit(xstatus);
   }
+
+  // throughput, to compare journal modes.
+  statfs(&b);
+  int t = uptime() - t0;
+  uint kb = (argc - 1) * N * SZ / 1024;
+  printf("%s: %s journal, %d KB in %d ticks (%d KB/s), log blocks=%lu disk writes=%lu\n",
+         argv[0], b.journal_mode == JOURNAL_ORDERED ? "ordered" : "full",
+         kb, t, t > 0 ? kb * 10 / t : 0,
+         b.log_commit_blocks - a.log_commit_blocks,
+         b.bcache_dev_writes - a.bcache_dev_writes);
   return 0;
 }
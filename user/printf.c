@@ -12,11 +12,51 @@ putc(int fd, char c)
   write(fd, &c, 1);
 }
 
+// Field width and flags of a conversion: %5d pads on the left
+// with spaces, %05d with zeros, %-5d on the right.
+struct field {
+  int width;
+  int left;
+  int zero;
+};
+
+static void
+pad(int fd, int n, char c)
+{
+  for(; n > 0; n--)
+    putc(fd, c);
+}
+
+// Print the n characters s[0..n-1] in field f.
 static void
-printint(int fd, long long xx, int base, int sgn)
+putfield(int fd, struct field *f, const char *s, int n)
 {
-  char buf[20];
-  int i, neg;
+  int fill = f->width - n;
+
+  if(f->left){
+    for(; n > 0; n--)
+      putc(fd, *s++);
+    pad(fd, fill, ' ');
+    return;
+  }
+  if(f->zero){
+    if(n > 0 && *s == '-'){
+      putc(fd, *s++);
+      n--;
+    }
+    pad(fd, fill, '0');
+  } else {
+    pad(fd, fill, ' ');
+  }
+  for(; n > 0; n--)
+    putc(fd, *s++);
+}
+
+static void
+printint(int fd, long long xx, int base, int sgn, struct field *f)
+{
+  char buf[24], out[24];
+  int i, n, neg;
   unsigned long long x;
 
   neg = 0;
@@ -34,25 +74,31 @@ printint(int fd, long long xx, int base, int sgn)
   if(neg)
     buf[i++] = '-';
 
-  while(--i >= 0)
-    putc(fd, buf[i]);
+  for(n = 0; --i >= 0; n++)
+    out[n] = buf[i];
+  putfield(fd, f, out, n);
 }
 
 static void
-printptr(int fd, uint64 x) {
-  int i;
-  putc(fd, '0');
-  putc(fd, 'x');
+printptr(int fd, uint64 x, struct field *f) {
+  char out[2 + sizeof(uint64) * 2];
+  int i, n = 0;
+  out[n++] = '0';
+  out[n++] = 'x';
   for (i = 0; i < (sizeof(uint64) * 2); i++, x <<= 4)
-    putc(fd, digits[x >> (sizeof(uint64) * 8 - 4)]);
+    out[n++] = digits[x >> (sizeof(uint64) * 8 - 4)];
+  putfield(fd, f, out, n);
 }
 
-// Print to the given fd. Only understands %d, %x, %p, %c, %s.
+// Print to the given fd. Only understands %d, %u, %x, %p, %c, %s
+// (with l or ll for 64-bit integers), each with an optional field
+// width and - or 0 flag.
 void
 vprintf(int fd, const char *fmt, va_list ap)
 {
-  char *s;
+  char *s, c;
   int c0, c1, c2, i, state;
+  struct field f;
 
   state = 0;
   for(i = 0; fmt[i]; i++){
@@ -64,42 +110,53 @@ vprintf(int fd, const char *fmt, va_list ap)
         putc(fd, c0);
       }
     } else if(state == '%'){
+      f.width = f.left = f.zero = 0;
+      for(; c0 == '-' || c0 == '0'; c0 = fmt[++i] & 0xff){
+        if(c0 == '-')
+          f.left = 1;
+        else
+          f.zero = 1;
+      }
+      for(; c0 >= '0' && c0 <= '9'; c0 = fmt[++i] & 0xff)
+        f.width = f.width * 10 + c0 - '0';
+      if(c0 == 0)
+        break;
       c1 = c2 = 0;
       if(c0) c1 = fmt[i+1] & 0xff;
       if(c1) c2 = fmt[i+2] & 0xff;
       if(c0 == 'd'){
-        printint(fd, va_arg(ap, int), 10, 1);
+        printint(fd, va_arg(ap, int), 10, 1, &f);
       } else if(c0 == 'l' && c1 == 'd'){
-        printint(fd, va_arg(ap, uint64), 10, 1);
+        printint(fd, va_arg(ap, uint64), 10, 1, &f);
         i += 1;
       } else if(c0 == 'l' && c1 == 'l' && c2 == 'd'){
-        printint(fd, va_arg(ap, uint64), 10, 1);
+        printint(fd, va_arg(ap, uint64), 10, 1, &f);
         i += 2;
       } else if(c0 == 'u'){
-        printint(fd, va_arg(ap, uint32), 10, 0);
+        printint(fd, va_arg(ap, uint32), 10, 0, &f);
       } else if(c0 == 'l' && c1 == 'u'){
-        printint(fd, va_arg(ap, uint64), 10, 0);
+        printint(fd, va_arg(ap, uint64), 10, 0, &f);
         i += 1;
       } else if(c0 == 'l' && c1 == 'l' && c2 == 'u'){
-        printint(fd, va_arg(ap, uint64), 10, 0);
+        printint(fd, va_arg(ap, uint64), 10, 0, &f);
         i += 2;
       } else if(c0 == 'x'){
-        printint(fd, va_arg(ap, uint32), 16, 0);
+        printint(fd, va_arg(ap, uint32), 16, 0, &f);
       } else if(c0 == 'l' && c1 == 'x'){
-        printint(fd, va_arg(ap, uint64), 16, 0);
+        printint(fd, va_arg(ap, uint64), 16, 0, &f);
         i += 1;
       } else if(c0 == 'l' && c1 == 'l' && c2 == 'x'){
-        printint(fd, va_arg(ap, uint64), 16, 0);
+        printint(fd, va_arg(ap, uint64), 16, 0, &f);
         i += 2;
       } else if(c0 == 'p'){
-        printptr(fd, va_arg(ap, uint64));
+        printptr(fd, va_arg(ap, uint64), &f);
       } else if(c0 == 'c'){
-        putc(fd, va_arg(ap, uint32));
+        c = va_arg(ap, uint32);
+        putfield(fd, &f, &c, 1);
       } else if(c0 == 's'){
         if((s = va_arg(ap, char*)) == 0)
           s = "(null)";
-        for(; *s; s++)
-          putc(fd, *s);
+        putfield(fd, &f, s, strlen(s));
       } else if(c0 == '%'){
         putc(fd, '%');
       } else {
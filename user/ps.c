@@ -3,6 +3,18 @@
 #include "kernel/hai_sysinfo.h"
 #include "user/user.h"
 
+// qemu virt's time base runs at 10MHz.
+#define CYCLES_PER_MS 10000
+
+static const char *class_name(int cls)
+{
+  switch(cls){
+    case HAI_SCHED_FAIR: return "fair";
+    case HAI_SCHED_RT: return "rt";
+    default: return "mlfq";
+  }
+}
+
 static const char *state_name(int st)
 {
   switch(st){
@@ -15,20 +27,32 @@ static const char *state_name(int st)
   }
 }
 
+static void
+print_proc(struct hai_procinfo *p)
+{
+  printf("%-4d %-4s %-4d %-6s %-3d %-4d %-6d %-6d %-6d %-6d %-5d %-5d %-3d %s\n",
+         p->pid, class_name(p->sched_class), p->priority, state_name(p->state),
+         p->last_cpu, (int)p->migrations, (int)p->rtime,
+         (int)(p->cputime / CYCLES_PER_MS), (int)(p->vruntime / CYCLES_PER_MS),
+         (int)p->sched_cnt,
+         (int)p->nvcsw, (int)p->nivcsw, (int)p->page_faults, p->name);
+}
+
 int
 main(int argc, char **argv)
 {
-  struct hai_schedinfo sc;
-  if(schedinfo(&sc) < 0){
-    printf("ps: schedinfo failed\n");
-    exit(1);
-  }
+  static struct hai_procinfo buf[16];
+  int cursor = 0, n;
 
-  printf("PID  PRIO STATE  RTIME  SCHED  PF  NAME\n");
-  for(int i = 0; i < sc.nreturned; i++){
-    struct hai_procinfo *p = &sc.procs[i];
-    printf("%-4d %-4d %-6s %-6d %-6d %-3d %s\n",
-           p->pid, p->priority, state_name(p->state), (int)p->rtime, (int)p->sched_cnt, (int)p->page_faults, p->name);
+  printf("PID  CLS  PRIO STATE  CPU MIG  RTIME  CPUMS  VRTMS  SCHED  VCSW  IVCSW PF  NAME\n");
+  // page through the whole process table, 16 entries at a time.
+  while((n = procsnap(&cursor, buf, 16)) > 0){
+    for(int i = 0; i < n; i++)
+      print_proc(&buf[i]);
+  }
+  if(n < 0){
+    printf("ps: procsnap failed\n");
+    exit(1);
   }
 
   exit(0);
@@ -0,0 +1,90 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/hai_sysinfo.h"
+#include "user/user.h"
+
+// Hai-OS 调度控制工具：查看/设置进程的 hart 亲和性、调度类与延迟期限。
+
+static void
+usage(void)
+{
+  fprintf(2, "usage: schedctl affinity <pid> [mask]\n");
+  fprintf(2, "       schedctl class <pid> [mlfq|fair|rt]\n");
+  fprintf(2, "       schedctl deadline <pid> <usec>\n");
+  exit(1);
+}
+
+// parse a hart mask given in decimal or 0x-prefixed hex.
+static int
+parsemask(const char *s)
+{
+  int m = 0;
+  if(s[0] == '0' && (s[1] == 'x' || s[1] == 'X')){
+    for(s += 2; *s; s++){
+      int d;
+      if(*s >= '0' && *s <= '9') d = *s - '0';
+      else if(*s >= 'a' && *s <= 'f') d = *s - 'a' + 10;
+      else if(*s >= 'A' && *s <= 'F') d = *s - 'A' + 10;
+      else return -1;
+      m = m * 16 + d;
+    }
+    return m;
+  }
+  return atoi(s);
+}
+
+int
+main(int argc, char **argv)
+{
+  if(argc < 3)
+    usage();
+
+  int pid = atoi(argv[2]);
+  if(strcmp(argv[1], "affinity") == 0){
+    if(argc == 4){
+      int mask = parsemask(argv[3]);
+      if(mask <= 0 || sched_setaffinity(pid, mask) < 0){
+        fprintf(2, "schedctl: set affinity pid=%d mask=%s failed\n", pid, argv[3]);
+        exit(1);
+      }
+    }
+    int mask = sched_getaffinity(pid);
+    if(mask < 0){
+      fprintf(2, "schedctl: no such pid %d\n", pid);
+      exit(1);
+    }
+    printf("pid %d affinity 0x%x\n", pid, mask);
+  } else if(strcmp(argv[1], "class") == 0){
+    if(argc == 4){
+      int cls;
+      if(strcmp(argv[3], "mlfq") == 0)
+        cls = HAI_SCHED_MLFQ;
+      else if(strcmp(argv[3], "fair") == 0)
+        cls = HAI_SCHED_FAIR;
+      else if(strcmp(argv[3], "rt") == 0)
+        cls = HAI_SCHED_RT;
+      else
+        usage();
+      if(sched_setclass(pid, cls) < 0){
+        fprintf(2, "schedctl: set class pid=%d %s failed\n", pid, argv[3]);
+        exit(1);
+      }
+    }
+    int cls = sched_getclass(pid);
+    if(cls < 0){
+      fprintf(2, "schedctl: no such pid %d\n", pid);
+      exit(1);
+    }
+    static const char *names[] = { "mlfq", "fair", "rt" };
+    printf("pid %d class %s\n", pid, names[cls]);
+  } else if(strcmp(argv[1], "deadline") == 0 && argc == 4){
+    if(sched_setdeadline(pid, atoi(argv[3])) < 0){
+      fprintf(2, "schedctl: set deadline pid=%d failed\n", pid);
+      exit(1);
+    }
+    printf("pid %d deadline %dus\n", pid, atoi(argv[3]));
+  } else {
+    usage();
+  }
+  exit(0);
+}
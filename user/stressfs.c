@@ -19,9 +19,13 @@ main(int argc, char *argv[])
   int fd, i;
   char path[] = "stressfs0";
   char data[512];
+  struct hai_statfs a, b;
 
   printf("stressfs starting\n");
   memset(data, 'a', sizeof(data));
+  int top = getpid();
+  statfs(&a);
+  int t0 = uptime();
 
   for(i = 0; i < 4; i++)
     if(fork() > 0)
@@ -45,5 +49,14 @@ main(int argc, char *argv[])
 
   wait(0);
 
+  if(getpid() == top){
+    // compare journal modes: full logs file data, ordered does not.
+    statfs(&b);
+    int t = uptime() - t0;
+    printf("stressfs: %s journal, %d ticks, log blocks=%lu disk writes=%lu\n",
+           b.journal_mode == JOURNAL_ORDERED ? "ordered" : "full", t,
+           b.log_commit_blocks - a.log_commit_blocks,
+           b.bcache_dev_writes - a.bcache_dev_writes);
+  }
   exit(0);
 }
@@ -1,3 +1,4 @@
+#include "kernel/param.h"
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "kernel/hai_sysinfo.h"
@@ -12,12 +13,12 @@ swap(struct hai_procinfo *a, struct hai_procinfo *b)
 }
 
 static void
-sort_by_rtime(struct hai_procinfo *arr, int n)
+sort_by_cputime(struct hai_procinfo *arr, int n)
 {
   for(int i = 0; i < n; i++){
     int maxidx = i;
     for(int j = i + 1; j < n; j++){
-      if(arr[j].rtime > arr[maxidx].rtime)
+      if(arr[j].cputime > arr[maxidx].cputime)
         maxidx = j;
     }
     if(maxidx != i)
@@ -25,6 +26,18 @@ sort_by_rtime(struct hai_procinfo *arr, int n)
   }
 }
 
+// qemu virt's time base runs at 10MHz.
+#define CYCLES_PER_MS 10000
+
+static const char *class_name(int cls)
+{
+  switch(cls){
+    case HAI_SCHED_FAIR: return "fair";
+    case HAI_SCHED_RT: return "rt";
+    default: return "mlfq";
+  }
+}
+
 static const char *state_name(int st)
 {
   switch(st){
@@ -37,12 +50,41 @@ static const char *state_name(int st)
   }
 }
 
+// upper bounds of the wakeup latency buckets (HAI_LAT_BASE_CYCLES << 2i
+// at the 10MHz qemu timebase).
+static const char *lat_label[HAI_LAT_BUCKETS] = {
+  "<100us", "<400us", "<1.6ms", "<6.4ms", "<26ms", "<102ms", "<410ms", ">=410ms",
+};
+
+// Jain's fairness index (x100) of the processes in class cls, over
+// CPU time divided by weight: 100 when every process got exactly its
+// weighted share, 100/n when one process got everything.
+static int
+jain_index(struct hai_procinfo *arr, int n, int cls, int *count)
+{
+  uint64 sum = 0, sumsq = 0;
+  int k = 0;
+  for(int i = 0; i < n; i++){
+    if(arr[i].sched_class != cls || arr[i].cputime == 0)
+      continue;
+    uint64 x = arr[i].cputime / CYCLES_PER_MS * 1024 / arr[i].weight;
+    sum += x;
+    sumsq += x * x;
+    k++;
+  }
+  *count = k;
+  if(k == 0 || sumsq == 0)
+    return 100;
+  return (int)(sum * sum * 100 / (k * sumsq));
+}
+
 int
 main(int argc, char **argv)
 {
   struct hai_sysinfo si;
   struct hai_vmstat vm;
-  struct hai_schedinfo sc;
+  static struct hai_schedinfo sc;
+  static struct hai_procinfo procs[NPROC];
   int rc_si = sysinfo(&si);
   int rc_vm = vmstat(&vm);
   int rc_sc = schedinfo(&sc);
@@ -51,22 +93,58 @@ main(int argc, char **argv)
     exit(1);
   }
 
+  // page through the whole process table.
+  int n = 0, cursor = 0, got;
+  while(n < NPROC && (got = procsnap(&cursor, procs + n, NPROC - n)) > 0)
+    n += got;
+
   printf("Hai-OS top (one-shot)\n");
   printf("  mem: total=%d free=%d pressure=%d%% faults=%d\n", (int)vm.total_pages, (int)vm.free_pages, vm.pressure_pct, (int)vm.page_faults);
   printf("  procs: total=%d runnable=%d running=%d sleep=%d zombie=%d ticks=%d\n",
          si.procs, sc.runnable, sc.running, sc.sleeping, sc.zombies, (int)sc.ticks);
+  for(int h = 0; h < HAI_MAX_HARTS; h++){
+    struct hai_hartstat *hs = &sc.harts[h];
+    if(!hs->online)
+      continue;
+    int idle = hs->total_cycles ? (int)(hs->idle_cycles * 100 / hs->total_cycles) : 0;
+    printf("  hart%d: csw=%d idle=%d%% rt_throttled=%d\n", h, (int)hs->nswitch, idle, (int)hs->rt_throttled);
+  }
+  printf("  wake->run:");
+  for(int b = 0; b < HAI_LAT_BUCKETS; b++)
+    printf(" %s=%d", lat_label[b], (int)sc.wakelat[b]);
+  // run delay covers every RUNNABLE->RUNNING, not just wakeups.
+  uint64 delay[HAI_LAT_BUCKETS];
+  memset(delay, 0, sizeof(delay));
+  for(int i = 0; i < n; i++)
+    for(int b = 0; b < HAI_LAT_BUCKETS; b++)
+      delay[b] += procs[i].rundelay[b];
+  printf("\n  run delay:");
+  for(int b = 0; b < HAI_LAT_BUCKETS; b++)
+    printf(" %s=%d", lat_label[b], (int)delay[b]);
+  printf("\n  ipi: sent=%d recv=%d migrations=%d\n", (int)sc.ipi_sent, (int)sc.ipi_recv, (int)sc.migrations);
 
-  int n = sc.nreturned;
-  if(n > HAI_MAX_PROCSNAPSHOT)
-    n = HAI_MAX_PROCSNAPSHOT;
-  sort_by_rtime(sc.procs, n);
+  int nm, nf;
+  int jm = jain_index(procs, n, HAI_SCHED_MLFQ, &nm);
+  int jf = jain_index(procs, n, HAI_SCHED_FAIR, &nf);
+  printf("  fair: procs=%d min_vruntime=%dms spread=%dms\n",
+         sc.nfair, (int)(sc.min_vruntime / CYCLES_PER_MS), (int)(sc.vruntime_spread / CYCLES_PER_MS));
+  printf("  fairness (Jain, cpu/weight): mlfq=%d%% (n=%d) fair=%d%% (n=%d)\n", jm, nm, jf, nf);
+  printf("  rt: procs=%d throttled=%d deadline misses=%d\n",
+         sc.nrt, (int)sc.rt_throttled, (int)sc.deadline_misses);
+  sort_by_cputime(procs, n);
 
   int show = n < 8 ? n : 8;
-  printf("\nPID  PRIO STATE  RTIME  SCHED  PF  NAME\n");
+  printf("\nPID  CLS  PRIO STATE  CPU MIG  CPUMS  VRTMS  SCHED  DLYAVG DLYMAX MISS VCSW  IVCSW NAME\n");
   for(int i = 0; i < show; i++){
-    struct hai_procinfo *p = &sc.procs[i];
-    printf("%-4d %-4d %-6s %-6d %-6d %-3d %s\n",
-           p->pid, p->priority, state_name(p->state), (int)p->rtime, (int)p->sched_cnt, (int)p->page_faults, p->name);
+    struct hai_procinfo *p = &procs[i];
+    // run delay in us: 10 time-base cycles each.
+    int avg = p->sched_cnt ? (int)(p->rundelay_sum / p->sched_cnt / 10) : 0;
+    printf("%-4d %-4s %-4d %-6s %-3d %-4d %-6d %-6d %-6d %-6d %-6d %-4d %-5d %-5d %s\n",
+           p->pid, class_name(p->sched_class), p->priority, state_name(p->state),
+           p->last_cpu, (int)p->migrations,
+           (int)(p->cputime / CYCLES_PER_MS), (int)(p->vruntime / CYCLES_PER_MS),
+           (int)p->sched_cnt, avg, (int)(p->rundelay_max / 10), (int)p->deadline_misses,
+           (int)p->nvcsw, (int)p->nivcsw, p->name);
   }
 
   exit(0);
@@ -39,6 +39,15 @@ int devinfo(struct hai_devinfo *out);
 int eventfd(void);
 int timerfd(void);
 int dmesg(void);
+int sched_setaffinity(int pid, int mask);
+int sched_getaffinity(int pid);
+int sched_setclass(int pid, int cls);
+int sched_getclass(int pid);
+int procsnap(int *cursor, struct hai_procinfo *buf, int max);
+int sched_setdeadline(int pid, int usec);
+int logcrash(int point);
+int fsync(int fd);
+int fdatasync(int fd);
 
 // ulib.c
 int stat(const char*, struct stat*);
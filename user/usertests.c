@@ -874,6 +874,136 @@ preempt(char *s)
   wait(0);
 }
 
+// pin to hart 0 and check that the mask sticks and is inherited.
+void
+affinity(char *s)
+{
+  int xst;
+
+  if(sched_setaffinity(0, 0) != -1){
+    printf("%s: empty mask accepted\n", s);
+    exit(1);
+  }
+  if(sched_setaffinity(0, 1) != 0 || sched_getaffinity(0) != 1){
+    printf("%s: pin to hart 0 failed\n", s);
+    exit(1);
+  }
+  int pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(int i = 0; i < 100000; i++)
+      getpid();
+    exit(sched_getaffinity(0) == 1 ? 0 : 1);
+  }
+  wait(&xst);
+  if(xst != 0){
+    printf("%s: child lost affinity\n", s);
+    exit(1);
+  }
+  if(sched_getaffinity(pid) != -1){
+    printf("%s: affinity of reaped pid\n", s);
+    exit(1);
+  }
+}
+
+// a spinning RT process on our hart must not starve us:
+// the RT throttle leaves ordinary processes some of every period,
+// so waking ROUNDS+1 times takes about (ROUNDS+1)*SCHED_RT_PERIOD
+// ticks; we allow twice that. A watchdog on another hart kills
+// the spinner after twice the bound, so a broken throttle fails
+// the test instead of hanging it.
+void
+rtthrottle(char *s)
+{
+  enum { ROUNDS = 5, BOUND = 2*(ROUNDS+1)*SCHED_RT_PERIOD };
+  int go[2], res[2], pid, dog, xst;
+  char c;
+
+  if(pipe(go) != 0 || pipe(res) != 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if(sched_setaffinity(0, 1) != 0){
+    printf("%s: pin to hart 0 failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    if(read(go[0], &c, 1) != 1)
+      exit(1);
+    c = sched_setclass(0, HAI_SCHED_RT) == 0 ? 'y' : 'n';
+    write(res[1], &c, 1);
+    for(;;)
+      ;
+  }
+  dog = fork();
+  if(dog < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(dog == 0){
+    // with a single hart there is nowhere to watch from.
+    if(sched_setaffinity(0, 0xff & ~1) != 0)
+      exit(0);
+    pause(2*BOUND);
+    kill(pid);
+    exit(0);
+  }
+
+  int t0 = uptime();
+  write(go[1], "g", 1);
+  if(read(res[0], &c, 1) != 1 || c != 'y'){
+    printf("%s: child could not become RT\n", s);
+    exit(1);
+  }
+  for(int i = 0; i < ROUNDS; i++)
+    pause(1);
+  int t = uptime() - t0;
+  kill(pid);
+  kill(dog);
+  for(int i = 0; i < 2; i++){
+    int w = wait(&xst);
+    if(w == pid && xst != -1){
+      printf("%s: RT child exited with %d\n", s, xst);
+      exit(1);
+    }
+  }
+  sched_setaffinity(0, 0xff);
+  if(t > BOUND){
+    printf("%s: starved for %d ticks by an RT spinner\n", s, t);
+    exit(1);
+  }
+}
+
+// page through the process table one entry at a time;
+// we should see ourselves exactly once.
+void
+procsnaptest(char *s)
+{
+  struct hai_procinfo pi;
+  int cursor = 0, n, seen = 0, calls = 0;
+
+  while((n = procsnap(&cursor, &pi, 1)) > 0){
+    if(n != 1 || ++calls > NPROC){
+      printf("%s: procsnap returned %d\n", s, n);
+      exit(1);
+    }
+    if(pi.pid == getpid())
+      seen++;
+  }
+  if(n < 0 || cursor != NPROC || seen != 1){
+    printf("%s: n=%d cursor=%d seen=%d\n", s, n, cursor, seen);
+    exit(1);
+  }
+}
+
 // try to find any races between exit and wait
 void
 exitwait(char *s)
@@ -1727,6 +1857,76 @@ bigwrite(char *s)
   }
 }
 
+// O_SYNC writes and fsync()/fdatasync() succeed on files,
+// and fsync() rejects a bad descriptor.
+void
+syncwrite(char *s)
+{
+  int fd;
+
+  unlink("syncwrite");
+  fd = open("syncwrite", O_CREATE | O_RDWR | O_SYNC);
+  if(fd < 0){
+    printf("%s: cannot create syncwrite\n", s);
+    exit(1);
+  }
+  for(int i = 0; i < 4; i++){
+    if(write(fd, buf, 777) != 777){
+      printf("%s: O_SYNC write failed\n", s);
+      exit(1);
+    }
+  }
+  if(fsync(fd) != 0 || fdatasync(fd) != 0){
+    printf("%s: fsync failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  if(fsync(fd) != -1){
+    printf("%s: fsync of a closed fd succeeded\n", s);
+    exit(1);
+  }
+  unlink("syncwrite");
+}
+
+// the in-memory free map must agree with what files take and give
+// back: a file of N blocks uses N blocks (one more if the directory
+// grows), and unlinking it returns them.
+void
+extentalloc(char *s)
+{
+  enum { N = 6 };
+  struct hai_statfs a, b, c;
+  int fd;
+
+  unlink("extentalloc");
+  statfs(&a);
+  fd = open("extentalloc", O_CREATE | O_RDWR);
+  if(fd < 0){
+    printf("%s: cannot create extentalloc\n", s);
+    exit(1);
+  }
+  for(int i = 0; i < N; i++){
+    if(write(fd, buf, BUFSZ) != BUFSZ){
+      printf("%s: write failed\n", s);
+      exit(1);
+    }
+  }
+  close(fd);
+  statfs(&b);
+  // the image's block size, not the compile-time BSIZE.
+  int want = (N*BUFSZ + a.block_size - 1) / a.block_size;
+  int used = a.free_blocks - b.free_blocks;
+  if(used < want || used > want + 1){
+    printf("%s: %d blocks used for %d\n", s, used, want);
+    exit(1);
+  }
+  unlink("extentalloc");
+  statfs(&c);
+  if(a.free_blocks - c.free_blocks > 1){
+    printf("%s: %d blocks not freed\n", s, a.free_blocks - c.free_blocks);
+    exit(1);
+  }
+}
 
 void
 bigfile(char *s)
@@ -2773,6 +2973,9 @@ struct test {
   {pipe1, "pipe1"},
   {killstatus, "killstatus"},
   {preempt, "preempt"},
+  {affinity, "affinity"},
+  {procsnaptest, "procsnap"},
+  {rtthrottle, "rtthrottle"},
   {exitwait, "exitwait"},
   {reparent, "reparent" },
   {twochildren, "twochildren"},
@@ -2789,6 +2992,8 @@ struct test {
   {linkunlink, "linkunlink"},
   {subdir, "subdir"},
   {bigwrite, "bigwrite"},
+  {syncwrite, "syncwrite"},
+  {extentalloc, "extentalloc"},
   {bigfile, "bigfile"},
   {fourteen, "fourteen"},
   {rmdot, "rmdot"},
@@ -55,3 +55,12 @@ entry("eventfd");
 entry("timerfd");
 entry("devinfo");
 entry("dmesg");
+entry("sched_setaffinity");
+entry("sched_getaffinity");
+entry("sched_setclass");
+entry("sched_getclass");
+entry("procsnap");
+entry("sched_setdeadline");
+entry("logcrash");
+entry("fsync");
+entry("fdatasync");